@@ -0,0 +1,142 @@
+#include <benchmark/benchmark.h>
+
+#include <atomic>
+#include <latch>
+#include <memory>
+#include <optional>
+#include <thread>
+#include <vector>
+
+#include "theta/queue/actor.h"
+
+namespace theta {
+
+class Pinger : public Actor<uint64_t> {
+ public:
+  Pinger(ActorScheduler& scheduler, std::latch& done)
+      : Actor(scheduler), done_(done) {}
+
+  void set_peer(Pinger* peer) { peer_ = peer; }
+
+ protected:
+  void receive(uint64_t volleys_left) override {
+    if (volleys_left == 1) {
+      done_.count_down();
+      return;
+    }
+    while (!peer_->send(volleys_left - 1)) {
+      std::this_thread::yield();
+    }
+  }
+
+ private:
+  std::latch& done_;
+  Pinger* peer_{nullptr};
+};
+
+// Pairs of actors bounce a message back and forth. Each volley is one send,
+// one activation, and one receive.
+static void BM_actor_ping_pong(benchmark::State& state) {
+  const int num_pairs = state.range(0);
+  static constexpr uint64_t kVolleys = 1000;
+
+  for (auto _ : state) {
+    std::latch done{num_pairs};
+    std::optional<DefaultActorScheduler> scheduler;
+    scheduler.emplace(state.range(1));
+
+    std::vector<std::unique_ptr<Pinger>> actors;
+    for (int i = 0; i < 2 * num_pairs; i++) {
+      actors.push_back(std::make_unique<Pinger>(*scheduler, done));
+    }
+    for (int i = 0; i < num_pairs; i++) {
+      actors[2 * i]->set_peer(actors[2 * i + 1].get());
+      actors[2 * i + 1]->set_peer(actors[2 * i].get());
+    }
+    for (int i = 0; i < num_pairs; i++) {
+      actors[2 * i]->send(kVolleys);
+    }
+
+    done.wait();
+    scheduler.reset();
+  }
+  state.SetItemsProcessed(state.iterations() * num_pairs * kVolleys);
+}
+BENCHMARK(BM_actor_ping_pong)
+    ->Args({1, 1})
+    ->Args({1, 4})
+    ->Args({1000, 1})
+    ->Args({1000, 4})
+    ->Unit(benchmark::kMillisecond)
+    ->UseRealTime();
+
+class Sink : public Actor<uint64_t> {
+ public:
+  Sink(ActorScheduler& scheduler, size_t mailbox_size, std::latch& done)
+      : Actor(scheduler, mailbox_size), done_(done) {}
+
+ protected:
+  void receive(uint64_t) override { done_.count_down(); }
+
+ private:
+  std::latch& done_;
+};
+
+class Source : public Actor<uint64_t> {
+ public:
+  Source(ActorScheduler& scheduler, Sink& sink)
+      : Actor(scheduler), sink_(sink) {}
+
+ protected:
+  void receive(uint64_t msg) override {
+    while (!sink_.send(msg)) {
+      std::this_thread::yield();
+    }
+  }
+
+ private:
+  Sink& sink_;
+};
+
+// Thousands of actors each forward messages to one sink.
+static void BM_actor_fan_in(benchmark::State& state) {
+  const int num_sources = state.range(0);
+  static constexpr int kMessagesPerSource = 16;
+
+  for (auto _ : state) {
+    std::latch done{num_sources * kMessagesPerSource};
+    std::optional<DefaultActorScheduler> scheduler;
+    scheduler.emplace(state.range(1));
+
+    // Sources block while the sink's mailbox is full, which would starve the
+    // sink of workers, so the mailbox holds every message.
+    Sink sink{*scheduler,
+              static_cast<size_t>(num_sources * kMessagesPerSource),
+              done};
+    std::vector<std::unique_ptr<Source>> sources;
+    for (int i = 0; i < num_sources; i++) {
+      sources.push_back(std::make_unique<Source>(*scheduler, sink));
+    }
+    for (int j = 1; j <= kMessagesPerSource; j++) {
+      for (auto& source : sources) {
+        source->send(j);
+      }
+    }
+
+    done.wait();
+    scheduler.reset();
+  }
+  state.SetItemsProcessed(state.iterations() * num_sources
+                          * kMessagesPerSource);
+}
+BENCHMARK(BM_actor_fan_in)
+    ->Args({1000, 1})
+    ->Args({1000, 4})
+    ->Args({10000, 1})
+    ->Args({10000, 4})
+    ->Unit(benchmark::kMillisecond)
+    ->UseRealTime();
+
+}  // namespace theta
+
+BENCHMARK_MAIN();
@@ -0,0 +1,69 @@
+#include <benchmark/benchmark.h>
+#include <fcntl.h>
+#include <fmt/format.h>
+#include <unistd.h>
+
+#include <string>
+
+#include "theta/queue/async-logger.h"
+
+namespace theta {
+
+static int open_dev_null() { return open("/dev/null", O_WRONLY | O_CLOEXEC); }
+
+// The baseline: format on the calling thread and write each line.
+static void BM_sync_log(benchmark::State& state) {
+  int fd = open_dev_null();
+  std::string name = "request";
+  fmt::memory_buffer out;
+  uint64_t i = 0;
+  for (auto _ : state) {
+    out.clear();
+    fmt::format_to(std::back_inserter(out),
+                   "{} {} took {:.3f} ms\n",
+                   name,
+                   i++,
+                   1.25);
+    benchmark::DoNotOptimize(write(fd, out.data(), out.size()));
+  }
+  close(fd);
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_sync_log)->Threads(1)->Threads(4)->UseRealTime();
+
+// The cost seen by the logging thread: encode the arguments into the ring.
+// The ring is flushed outside the timed region often enough that records are
+// not dropped.
+static void BM_async_log(benchmark::State& state) {
+  static int fd;
+  static AsyncLogger* logger;
+  static constexpr uint64_t kFlushInterval = 4096;
+  if (state.thread_index() == 0) {
+    fd = open_dev_null();
+    logger = new AsyncLogger{fd};
+  }
+
+  std::string name = "request";
+  uint64_t i = 0;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(
+        logger->log("{} {} took {:.3f} ms", name, i++, 1.25));
+    if (i % kFlushInterval == 0) {
+      state.PauseTiming();
+      logger->flush();
+      state.ResumeTiming();
+    }
+  }
+
+  if (state.thread_index() == 0) {
+    state.counters["dropped"] = logger->dropped();
+    delete logger;
+    close(fd);
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_async_log)->Threads(1)->Threads(4)->UseRealTime();
+
+}  // namespace theta
+
+BENCHMARK_MAIN();
@@ -0,0 +1,61 @@
+#include <benchmark/benchmark.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+#include "theta/queue/batcher.h"
+#include "theta/queue/mpmc-queue.h"
+
+namespace theta {
+
+static constexpr uint64_t kNumItems = 1 << 17;
+
+// A producer pushes kNumItems items while the consumer writes them to
+// /dev/null in batches of up to state.range(0) items, one write(2) per batch.
+// A batch size of 1 is the item-at-a-time baseline.
+static void BM_batched_sink(benchmark::State& state) {
+  using namespace std::chrono_literals;
+  const size_t max_items = state.range(0);
+  int fd = open("/dev/null", O_WRONLY | O_CLOEXEC);
+
+  for (auto _ : state) {
+    MPMCQueue<uint64_t, 4096> queue;
+    Batcher batcher{queue, max_items, /*max_delay=*/100us};
+
+    std::thread producer{[&]() {
+      for (uint64_t i = 1; i <= kNumItems; i++) {
+        queue.push(i);
+      }
+    }};
+
+    std::vector<uint64_t> batch;
+    uint64_t received = 0;
+    while (received < kNumItems) {
+      size_t n = batcher.next_batch(batch);
+      benchmark::DoNotOptimize(
+          write(fd, batch.data(), n * sizeof(uint64_t)));
+      received += n;
+    }
+    producer.join();
+
+    state.counters["mean_batch"] = batcher.stats().mean_batch_size();
+    state.counters["mean_delay_us"]
+        = batcher.stats().mean_delay().count() / 1000.0;
+  }
+  close(fd);
+  state.SetItemsProcessed(state.iterations() * kNumItems);
+}
+BENCHMARK(BM_batched_sink)
+    ->Arg(1)
+    ->Arg(16)
+    ->Arg(256)
+    ->Unit(benchmark::kMillisecond)
+    ->UseRealTime();
+
+}  // namespace theta
+
+BENCHMARK_MAIN();
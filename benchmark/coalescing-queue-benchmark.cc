@@ -0,0 +1,90 @@
+#include <benchmark/benchmark.h>
+
+#include <atomic>
+#include <cstdint>
+#include <optional>
+#include <thread>
+
+#include "theta/queue/coalescing-queue.h"
+#include "theta/queue/mpmc-queue.h"
+
+namespace theta {
+
+static constexpr size_t kNumKeys = 1024;
+static constexpr uint64_t kNumSignals = 1 << 18;
+
+// The baseline: every signal is queued and processed.
+class PlainQueue {
+ public:
+  bool push(uint32_t key) {
+    queue_.push(key);
+    return true;
+  }
+
+  std::optional<uint32_t> try_pop() { return queue_.try_pop(); }
+
+ private:
+  MPMCQueue<uint32_t, 4096> queue_;
+};
+
+class CoalescingKeys : public CoalescingQueue<kNumKeys> {};
+
+// Stands in for recomputing a key.
+static uint64_t recompute(uint32_t key) {
+  uint64_t x = key;
+  for (int i = 0; i < 256; i++) {
+    x = x * 6364136223846793005ULL + 1442695040888963407ULL;
+  }
+  return x;
+}
+
+// A producer signals kNumSignals updates to state.range(0) hot keys while the
+// consumer recomputes each key it pops.
+template <typename Queue>
+static void BM_invalidations(benchmark::State& state) {
+  const uint32_t num_hot_keys = state.range(0);
+  uint64_t processed = 0;
+
+  for (auto _ : state) {
+    Queue queue;
+    std::atomic<bool> done{false};
+    std::thread producer{[&]() {
+      for (uint64_t i = 0; i < kNumSignals; i++) {
+        queue.push((i * 2654435761u) % num_hot_keys);
+      }
+      done.store(true, std::memory_order::release);
+    }};
+
+    uint64_t sum = 0;
+    while (true) {
+      const bool finished = done.load(std::memory_order::acquire);
+      if (auto key = queue.try_pop()) {
+        sum += recompute(*key);
+        processed++;
+      } else if (finished) {
+        break;
+      } else {
+        std::this_thread::yield();
+      }
+    }
+    producer.join();
+    benchmark::DoNotOptimize(sum);
+  }
+  state.SetItemsProcessed(state.iterations() * kNumSignals);
+  state.counters["recomputes"] = benchmark::Counter(
+      processed, benchmark::Counter::kAvgIterations);
+}
+BENCHMARK_TEMPLATE(BM_invalidations, PlainQueue)
+    ->Arg(16)
+    ->Arg(1024)
+    ->Unit(benchmark::kMillisecond)
+    ->UseRealTime();
+BENCHMARK_TEMPLATE(BM_invalidations, CoalescingKeys)
+    ->Arg(16)
+    ->Arg(1024)
+    ->Unit(benchmark::kMillisecond)
+    ->UseRealTime();
+
+}  // namespace theta
+
+BENCHMARK_MAIN();
@@ -0,0 +1,98 @@
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "theta/queue/codel-queue.h"
+
+namespace theta {
+
+static constexpr uint32_t kNumBursts = 1000;
+static constexpr uint32_t kBurstSize = 300;
+static constexpr uint32_t kNumItems = kNumBursts * kBurstSize;
+
+static uint64_t now_ns() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+// Stands in for handling an item, at a few microseconds each.
+static uint64_t process(uint64_t item) {
+  for (int i = 0; i < 4096; i++) {
+    item = item * 6364136223846793005ULL + 1442695040888963407ULL;
+  }
+  return item;
+}
+
+// A producer offers a burst of kBurstSize items every millisecond, more than
+// the consumer can handle. With state.range(0) == 0, CoDel's target is out
+// of reach and the queue only sheds load when it is full; with 1, CoDel uses
+// a 1ms target, a 10ms interval, and rejection. Reports the latency of
+// delivered items and how many were delivered.
+static void BM_overload(benchmark::State& state) {
+  using namespace std::chrono_literals;
+  const bool codel = state.range(0);
+  const QueueOpts opts = codel ? QueueOpts{}.set_codel(1ms, 10ms, true)
+                               : QueueOpts{}.set_codel(1000s, 1000s);
+  auto pushed_at = std::make_unique<std::atomic<uint64_t>[]>(kNumItems);
+  std::vector<uint64_t> latencies;
+  uint64_t delivered = 0;
+
+  for (auto _ : state) {
+    CoDelQueue<4096> queue{opts};
+    std::atomic<bool> done{false};
+    std::thread producer{[&]() {
+      auto next_burst = std::chrono::steady_clock::now();
+      for (uint32_t i = 0; i < kNumItems; i++) {
+        if (i % kBurstSize == 0) {
+          std::this_thread::sleep_until(next_burst);
+          next_burst += 1ms;
+        }
+        pushed_at[i].store(now_ns(), std::memory_order::relaxed);
+        queue.try_push(i);
+      }
+      done.store(true, std::memory_order::release);
+    }};
+
+    uint64_t sum = 0;
+    while (true) {
+      const bool finished = done.load(std::memory_order::acquire);
+      if (auto item = queue.try_pop()) {
+        sum += process(*item);
+        uint64_t pushed = pushed_at[*item].load(std::memory_order::relaxed);
+        latencies.push_back(now_ns() - pushed);
+        delivered++;
+      } else if (finished) {
+        break;
+      } else {
+        std::this_thread::yield();
+      }
+    }
+    producer.join();
+    benchmark::DoNotOptimize(sum);
+  }
+
+  std::sort(latencies.begin(), latencies.end());
+  auto percentile = [&](double p) {
+    return latencies[static_cast<size_t>(p * (latencies.size() - 1))] / 1e6;
+  };
+  state.counters["p50_ms"] = percentile(0.5);
+  state.counters["p99_ms"] = percentile(0.99);
+  state.counters["delivered"] = benchmark::Counter(
+      delivered, benchmark::Counter::kAvgIterations);
+}
+BENCHMARK(BM_overload)
+    ->Arg(0)
+    ->Arg(1)
+    ->Unit(benchmark::kMillisecond)
+    ->UseRealTime();
+
+}  // namespace theta
+
+BENCHMARK_MAIN();
@@ -0,0 +1,106 @@
+#include <benchmark/benchmark.h>
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "theta/queue/core-mesh.h"
+#include "theta/queue/mpmc-queue.h"
+
+namespace theta {
+
+static constexpr uint64_t kMessagesPerCore = 1 << 16;
+
+// The baseline: one MPMCQueue inbox per core, shared by every sender.
+class SharedInboxes {
+ public:
+  explicit SharedInboxes(size_t num_cores) {
+    for (size_t i = 0; i < num_cores; i++) {
+      inboxes_.push_back(std::make_unique<MPMCQueue<uint64_t, 1024>>());
+    }
+  }
+
+  bool send(size_t, size_t dst, uint64_t msg) {
+    return inboxes_[dst]->try_push(msg);
+  }
+
+  template <typename Fn>
+  size_t poll(size_t dst, Fn&& fn) {
+    size_t n = 0;
+    while (auto msg = inboxes_[dst]->try_pop()) {
+      fn(0, *msg);
+      n++;
+    }
+    return n;
+  }
+
+ private:
+  std::vector<std::unique_ptr<MPMCQueue<uint64_t, 1024>>> inboxes_;
+};
+
+// Each core sends kMessagesPerCore messages round-robin to the other cores
+// while polling its own inbox, until every message has been received.
+template <typename Mesh>
+static void BM_all_to_all(benchmark::State& state) {
+  const size_t num_cores = state.range(0);
+  const uint64_t total = num_cores * kMessagesPerCore;
+
+  for (auto _ : state) {
+    Mesh mesh{num_cores};
+    std::atomic<uint64_t> received{0};
+    std::vector<std::thread> cores;
+    for (size_t core = 0; core < num_cores; core++) {
+      cores.emplace_back([&, core]() {
+        uint64_t sum = 0;
+        auto on_message = [&](size_t, uint64_t msg) { sum += msg; };
+        auto poll = [&]() {
+          size_t n = mesh.poll(core, on_message);
+          if (n > 0) {
+            received.fetch_add(n, std::memory_order::relaxed);
+          }
+          return n;
+        };
+
+        for (uint64_t i = 0; i < kMessagesPerCore; i++) {
+          size_t dst = (core + 1 + i % (num_cores - 1)) % num_cores;
+          while (!mesh.send(core, dst, i)) {
+            if (poll() == 0) {
+              std::this_thread::yield();
+            }
+          }
+          if (i % 64 == 0) {
+            poll();
+          }
+        }
+        while (received.load(std::memory_order::relaxed) < total) {
+          if (poll() == 0) {
+            std::this_thread::yield();
+          }
+        }
+        benchmark::DoNotOptimize(sum);
+      });
+    }
+    for (auto& t : cores) {
+      t.join();
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * num_cores * kMessagesPerCore);
+}
+BENCHMARK_TEMPLATE(BM_all_to_all, SharedInboxes)
+    ->Arg(2)
+    ->Arg(4)
+    ->Arg(8)
+    ->Unit(benchmark::kMillisecond)
+    ->UseRealTime();
+BENCHMARK_TEMPLATE(BM_all_to_all, CoreMesh<uint64_t>)
+    ->Arg(2)
+    ->Arg(4)
+    ->Arg(8)
+    ->Unit(benchmark::kMillisecond)
+    ->UseRealTime();
+
+}  // namespace theta
+
+BENCHMARK_MAIN();
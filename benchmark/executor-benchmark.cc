@@ -0,0 +1,252 @@
+#include <benchmark/benchmark.h>
+#include <pthread.h>
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <latch>
+#include <thread>
+#include <vector>
+
+#include "theta/queue/mpmc-queue.h"
+#include "theta/queue/queue-event.h"
+#include "theta/queue/waiter-registry.h"
+#include "theta/queue/work-stealing-executor.h"
+
+namespace theta {
+
+// The baseline: every worker blocks on one shared MPMCQueue.
+class SharedQueuePool {
+  using Task = std::function<void()>;
+
+ public:
+  explicit SharedQueuePool(size_t num_workers) {
+    for (size_t i = 0; i < num_workers; i++) {
+      workers_.emplace_back([this]() {
+        while (Task* task = queue_.pop()) {
+          (*task)();
+          delete task;
+        }
+      });
+    }
+  }
+
+  ~SharedQueuePool() {
+    for (size_t i = 0; i < workers_.size(); i++) {
+      queue_.push(nullptr);
+    }
+    for (auto& w : workers_) {
+      w.join();
+    }
+  }
+
+  template <typename F>
+  void submit(F&& f) {
+    queue_.push(new Task{std::forward<F>(f)});
+  }
+
+ private:
+  MPMCQueue<Task*, 1 << 16> queue_;
+  std::vector<std::thread> workers_;
+};
+
+template <typename Pool>
+static void spawn_tree(Pool& pool, int depth, std::latch& done) {
+  if (depth == 0) {
+    done.count_down();
+    return;
+  }
+  for (int i = 0; i < 2; i++) {
+    pool.submit([&pool, &done, depth]() { spawn_tree(pool, depth - 1, done); });
+  }
+}
+
+// Recursive fork-join: each task spawns two children until the leaves.
+template <typename Pool>
+static void BM_fork_join(benchmark::State& state) {
+  static constexpr int kDepth = 14;
+  Pool pool(state.range(0));
+
+  for (auto _ : state) {
+    std::latch done{1 << kDepth};
+    pool.submit([&]() { spawn_tree(pool, kDepth, done); });
+    done.wait();
+  }
+  state.SetItemsProcessed(state.iterations() * ((2 << kDepth) - 1));
+}
+BENCHMARK_TEMPLATE(BM_fork_join, SharedQueuePool)
+    ->Arg(1)
+    ->Arg(2)
+    ->Arg(4)
+    ->Arg(8)
+    ->UseRealTime();
+BENCHMARK_TEMPLATE(BM_fork_join, WorkStealingExecutor)
+    ->Arg(1)
+    ->Arg(2)
+    ->Arg(4)
+    ->Arg(8)
+    ->UseRealTime();
+
+// Fine-grained tasks submitted from outside the pool.
+template <typename Pool>
+static void BM_external_submit(benchmark::State& state) {
+  static constexpr int kNumTasks = 10000;
+  Pool pool(state.range(0));
+  std::atomic<uint64_t> sink{0};
+
+  for (auto _ : state) {
+    std::latch done{kNumTasks};
+    for (int i = 0; i < kNumTasks; i++) {
+      pool.submit([&]() {
+        sink.fetch_add(1, std::memory_order::relaxed);
+        done.count_down();
+      });
+    }
+    done.wait();
+  }
+  state.SetItemsProcessed(state.iterations() * kNumTasks);
+}
+BENCHMARK_TEMPLATE(BM_external_submit, SharedQueuePool)
+    ->Arg(1)
+    ->Arg(2)
+    ->Arg(4)
+    ->Arg(8)
+    ->UseRealTime();
+BENCHMARK_TEMPLATE(BM_external_submit, WorkStealingExecutor)
+    ->Arg(1)
+    ->Arg(2)
+    ->Arg(4)
+    ->Arg(8)
+    ->UseRealTime();
+
+static void pin_to_cpu(std::thread::native_handle_type thread, int cpu) {
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  CPU_SET(cpu, &set);
+  pthread_setaffinity_np(thread, sizeof(set), &set);
+}
+
+// Parks on a QueueEvent, which wakes an arbitrary waiter.
+struct AnyWaiter {
+  QueueEvent event;
+
+  template <typename Pred>
+  void park_unless(Pred ready) {
+    uint32_t epoch = event.prepare_wait();
+    if (ready()) {
+      event.cancel_wait();
+    } else {
+      event.wait(epoch);
+    }
+  }
+  void notify() { event.notify(); }
+  void notify_all() { event.notify_all(); }
+};
+
+// Parks in a WaiterRegistry, which wakes the waiter closest to the notifier.
+struct ClosestWaiter {
+  WaiterRegistry registry;
+
+  template <typename Pred>
+  void park_unless(Pred ready) {
+    WaiterRegistry::Waiter waiter;
+    registry.prepare_wait(waiter);
+    if (ready()) {
+      registry.cancel_wait(waiter);
+    } else {
+      registry.wait(waiter);
+    }
+  }
+  void notify() { registry.notify(); }
+  void notify_all() { registry.notify_all(); }
+};
+
+// A producer pinned to CPU 0 fills a payload and wakes one of several parked
+// consumers spread over every CPU. The woken consumer times its first pass
+// over the payload, which misses in its caches unless it shares a last-level
+// cache with the producer. Reports the mean first-touch time and the fraction
+// of wakeups that landed on the producer's last-level cache.
+template <typename Parking>
+static void BM_wakeup_first_touch(benchmark::State& state) {
+  static constexpr size_t kPayloadWords = 32 * 1024;
+  const int num_consumers = state.range(0);
+  const int num_cpus = std::thread::hardware_concurrency();
+
+  pin_to_cpu(pthread_self(), 0);
+  const int producer_llc = internal::current_cpu_location().llc;
+
+  Parking parking;
+  std::vector<uint64_t> payload(kPayloadWords);
+  std::atomic<uint64_t> round{0};
+  std::atomic<uint64_t> claimed{0};
+  std::atomic<uint64_t> done{0};
+  std::atomic<bool> stopping{false};
+  std::atomic<int64_t> touch_ns{0};
+  std::atomic<int64_t> same_llc{0};
+
+  auto work_pending = [&]() {
+    return stopping.load(std::memory_order::seq_cst)
+        || claimed.load(std::memory_order::seq_cst)
+               < round.load(std::memory_order::seq_cst);
+  };
+
+  std::vector<std::thread> consumers;
+  for (int i = 0; i < num_consumers; i++) {
+    consumers.emplace_back([&]() {
+      while (!stopping.load(std::memory_order::seq_cst)) {
+        uint64_t r = round.load(std::memory_order::seq_cst);
+        uint64_t c = claimed.load(std::memory_order::seq_cst);
+        if (c < r && claimed.compare_exchange_strong(c, r)) {
+          auto start = std::chrono::steady_clock::now();
+          uint64_t sum = 0;
+          for (uint64_t word : payload) {
+            sum += word;
+          }
+          benchmark::DoNotOptimize(sum);
+          touch_ns += std::chrono::nanoseconds{std::chrono::steady_clock::now()
+                                               - start}
+                          .count();
+          same_llc += internal::current_cpu_location().llc == producer_llc;
+          done.store(r, std::memory_order::release);
+          continue;
+        }
+        parking.park_unless(work_pending);
+      }
+    });
+    pin_to_cpu(consumers.back().native_handle(), (i + 1) % num_cpus);
+  }
+
+  uint64_t rounds = 0;
+  for (auto _ : state) {
+    rounds++;
+    for (uint64_t& word : payload) {
+      word = rounds;
+    }
+    round.store(rounds, std::memory_order::seq_cst);
+    parking.notify();
+    while (done.load(std::memory_order::acquire) != rounds) {
+      std::this_thread::yield();
+    }
+  }
+
+  stopping.store(true, std::memory_order::seq_cst);
+  parking.notify_all();
+  for (auto& t : consumers) {
+    t.join();
+  }
+
+  state.counters["first_touch_ns"] = static_cast<double>(touch_ns) / rounds;
+  state.counters["same_llc"] = static_cast<double>(same_llc) / rounds;
+}
+BENCHMARK_TEMPLATE(BM_wakeup_first_touch, AnyWaiter)
+    ->Arg(4)
+    ->Arg(16)
+    ->UseRealTime();
+BENCHMARK_TEMPLATE(BM_wakeup_first_touch, ClosestWaiter)
+    ->Arg(4)
+    ->Arg(16)
+    ->UseRealTime();
+
+}  // namespace theta
+
+BENCHMARK_MAIN();
@@ -0,0 +1,122 @@
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <optional>
+#include <thread>
+#include <vector>
+
+#include "theta/queue/fair-queue.h"
+#include "theta/queue/mpmc-queue.h"
+
+namespace theta {
+
+static constexpr size_t kCapacity = 1024;
+static constexpr uint64_t kLightItems = 2000;
+
+// The baseline: both tenants share one FIFO. Pushes take a ticket and wait
+// for space, since with try_push() the heavy tenant would take nearly every
+// freed slot and the light tenant could barely get in at all.
+class SharedFifo {
+ public:
+  bool try_push(size_t, uint64_t val) {
+    queue_.push(val);
+    return true;
+  }
+
+  std::optional<uint64_t> try_pop() { return queue_.try_pop(); }
+
+ private:
+  MPMCQueue<uint64_t, kCapacity> queue_;
+};
+
+class FairTenants : public FairQueue<uint64_t> {
+ public:
+  FairTenants()
+      : FairQueue<uint64_t>({1, 1}, QueueOpts{}.set_max_size(kCapacity)) {}
+};
+
+static uint64_t now_ns() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+// Stands in for handling an item.
+static uint64_t process(uint64_t item) {
+  for (int i = 0; i < 64; i++) {
+    item = item * 6364136223846793005ULL + 1442695040888963407ULL;
+  }
+  return item;
+}
+
+// Tenant 0 pushes as fast as it can while tenant 1 pushes kLightItems
+// timestamped items at a trickle. Reports the latency of tenant 1's items,
+// from push to pop. Items carry their tenant in the low bit.
+template <typename Queue>
+static void BM_light_tenant_latency(benchmark::State& state) {
+  std::vector<uint64_t> latencies;
+
+  for (auto _ : state) {
+    Queue queue;
+    std::atomic<bool> stop{false};
+
+    std::thread heavy{[&]() {
+      while (!stop.load(std::memory_order::relaxed)) {
+        if (!queue.try_push(0, /*val=*/2)) {
+          std::this_thread::yield();
+        }
+      }
+    }};
+    std::thread light{[&]() {
+      for (uint64_t i = 0; i < kLightItems; i++) {
+        while (!queue.try_push(1, (now_ns() << 1) | 1)) {
+          std::this_thread::yield();
+        }
+        std::this_thread::yield();
+      }
+    }};
+
+    uint64_t sum = 0;
+    uint64_t received = 0;
+    while (received < kLightItems) {
+      auto val = queue.try_pop();
+      if (!val) {
+        std::this_thread::yield();
+        continue;
+      }
+      sum += process(*val);
+      if (*val & 1) {
+        latencies.push_back(now_ns() - (*val >> 1));
+        received++;
+      }
+    }
+    stop.store(true, std::memory_order::relaxed);
+    // Unblock the heavy producer if it is waiting for space.
+    while (queue.try_pop()) {
+    }
+    heavy.join();
+    light.join();
+    benchmark::DoNotOptimize(sum);
+  }
+
+  std::sort(latencies.begin(), latencies.end());
+  auto percentile = [&](double p) {
+    return latencies[static_cast<size_t>(p * (latencies.size() - 1))] / 1e3;
+  };
+  state.counters["p50_us"] = percentile(0.5);
+  state.counters["p99_us"] = percentile(0.99);
+  state.counters["max_us"] = latencies.back() / 1e3;
+}
+BENCHMARK_TEMPLATE(BM_light_tenant_latency, SharedFifo)
+    ->Unit(benchmark::kMillisecond)
+    ->UseRealTime();
+BENCHMARK_TEMPLATE(BM_light_tenant_latency, FairTenants)
+    ->Unit(benchmark::kMillisecond)
+    ->UseRealTime();
+
+}  // namespace theta
+
+BENCHMARK_MAIN();
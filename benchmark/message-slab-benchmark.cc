@@ -0,0 +1,137 @@
+#include <benchmark/benchmark.h>
+
+#include <atomic>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+#include "theta/queue/message-slab.h"
+#include "theta/queue/mpmc-queue.h"
+
+namespace theta {
+
+struct Message {
+  uint64_t fields[6];
+};
+
+static constexpr size_t kQueueSize = 1024;
+
+// The baseline: a heap allocation per message and a pointer through the
+// queue.
+struct HeapQueue {
+  MPMCQueue<Message*, kQueueSize> queue;
+
+  void send(uint64_t v) {
+    queue.push(new Message{{v, v, v, v, v, v}});
+  }
+
+  uint64_t receive() {
+    Message* msg = queue.pop();
+    uint64_t v = msg->fields[0] + msg->fields[5];
+    delete msg;
+    return v;
+  }
+
+  size_t receive_batch(uint64_t& sum) {
+    auto msg = queue.try_pop();
+    if (!msg) {
+      return 0;
+    }
+    sum += (*msg)->fields[0] + (*msg)->fields[5];
+    delete *msg;
+    return 1;
+  }
+};
+
+struct SlabQueueAdaptor {
+  SlabQueue<Message, kQueueSize> queue;
+
+  void send(uint64_t v) { queue.emplace(Message{{v, v, v, v, v, v}}); }
+
+  uint64_t receive() {
+    uint64_t v;
+    queue.consume(
+        [&](const Message& msg) { v = msg.fields[0] + msg.fields[5]; });
+    return v;
+  }
+
+  size_t receive_batch(uint64_t& sum) {
+    return queue.try_consume_n(
+        [&](const Message& msg) { sum += msg.fields[0] + msg.fields[5]; });
+  }
+};
+
+template <typename Q, bool kBatch>
+static void BM_messages(benchmark::State& state) {
+  const int num_producers = state.range(0);
+  const int num_consumers = state.range(0);
+  static constexpr uint64_t kMessagesPerProducer = 1 << 16;
+
+  for (auto _ : state) {
+    Q q;
+    std::atomic<int64_t> remaining{
+        static_cast<int64_t>(num_producers * kMessagesPerProducer)};
+    std::vector<std::thread> threads;
+    for (int p = 0; p < num_producers; p++) {
+      threads.emplace_back([&]() {
+        for (uint64_t i = 0; i < kMessagesPerProducer; i++) {
+          q.send(i);
+        }
+      });
+    }
+    for (int c = 0; c < num_consumers; c++) {
+      threads.emplace_back([&]() {
+        uint64_t sum = 0;
+        if constexpr (kBatch) {
+          // A batch may take another consumer's share, so the consumers count
+          // down a shared total.
+          while (remaining.load(std::memory_order::relaxed) > 0) {
+            size_t n = q.receive_batch(sum);
+            if (n == 0) {
+              std::this_thread::yield();
+            }
+            remaining.fetch_sub(n, std::memory_order::relaxed);
+          }
+        } else {
+          for (uint64_t i = 0; i < kMessagesPerProducer; i++) {
+            sum += q.receive();
+          }
+        }
+        benchmark::DoNotOptimize(sum);
+      });
+    }
+    for (auto& t : threads) {
+      t.join();
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * num_producers
+                          * kMessagesPerProducer);
+}
+BENCHMARK(BM_messages<HeapQueue, /*kBatch=*/false>)
+    ->Arg(1)
+    ->Arg(2)
+    ->Arg(4)
+    ->Unit(benchmark::kMillisecond)
+    ->UseRealTime();
+BENCHMARK(BM_messages<HeapQueue, /*kBatch=*/true>)
+    ->Arg(1)
+    ->Arg(2)
+    ->Arg(4)
+    ->Unit(benchmark::kMillisecond)
+    ->UseRealTime();
+BENCHMARK(BM_messages<SlabQueueAdaptor, /*kBatch=*/false>)
+    ->Arg(1)
+    ->Arg(2)
+    ->Arg(4)
+    ->Unit(benchmark::kMillisecond)
+    ->UseRealTime();
+BENCHMARK(BM_messages<SlabQueueAdaptor, /*kBatch=*/true>)
+    ->Arg(1)
+    ->Arg(2)
+    ->Arg(4)
+    ->Unit(benchmark::kMillisecond)
+    ->UseRealTime();
+
+}  // namespace theta
+
+BENCHMARK_MAIN();
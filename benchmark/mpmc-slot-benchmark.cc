@@ -0,0 +1,147 @@
+#include <benchmark/benchmark.h>
+#include <sys/resource.h>
+
+#include <chrono>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+#include "theta/queue/mpmc-queue.h"
+
+namespace theta {
+
+// 32-bit items use the compact 8-byte slot layout; 64-bit items use the
+// 16-byte layout.
+template <typename T>
+static void BM_mpmc_push_pop(benchmark::State& state) {
+  const int num_pairs = state.range(0);
+  static constexpr uint64_t kItemsPerProducer = 1 << 16;
+
+  for (auto _ : state) {
+    MPMCQueue<T, 1024> queue;
+    std::vector<std::thread> threads;
+    for (int i = 0; i < num_pairs; i++) {
+      threads.emplace_back([&]() {
+        for (uint64_t j = 0; j < kItemsPerProducer; j++) {
+          queue.push(static_cast<T>(j));
+        }
+      });
+      threads.emplace_back([&]() {
+        uint64_t sum = 0;
+        for (uint64_t j = 0; j < kItemsPerProducer; j++) {
+          sum += queue.pop();
+        }
+        benchmark::DoNotOptimize(sum);
+      });
+    }
+    for (auto& t : threads) {
+      t.join();
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * num_pairs * kItemsPerProducer);
+}
+BENCHMARK(BM_mpmc_push_pop<uint32_t>)
+    ->Arg(1)
+    ->Arg(2)
+    ->Arg(4)
+    ->Unit(benchmark::kMillisecond)
+    ->UseRealTime();
+BENCHMARK(BM_mpmc_push_pop<uint64_t>)
+    ->Arg(1)
+    ->Arg(2)
+    ->Arg(4)
+    ->Unit(benchmark::kMillisecond)
+    ->UseRealTime();
+
+// Drains a full queue one item at a time with try_pop(), or in batches with
+// try_pop_n(), which claims the ready prefix with one update of head.
+template <typename T, bool kBatch>
+static void BM_mpmc_drain(benchmark::State& state) {
+  static constexpr size_t kSize = 1024;
+  const size_t batch = state.range(0);
+  MPMCQueue<T, kSize> queue;
+  std::vector<T> out(batch);
+
+  for (auto _ : state) {
+    state.PauseTiming();
+    for (size_t i = 0; i < kSize - 1; i++) {
+      queue.push(static_cast<T>(i));
+    }
+    state.ResumeTiming();
+
+    if constexpr (kBatch) {
+      while (queue.try_pop_n(out.data(), batch) > 0) {
+      }
+    } else {
+      while (queue.try_pop()) {
+      }
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * (kSize - 1));
+}
+BENCHMARK(BM_mpmc_drain<uint32_t, /*kBatch=*/false>)->Arg(1);
+BENCHMARK(BM_mpmc_drain<uint32_t, /*kBatch=*/true>)->Arg(8)->Arg(64);
+BENCHMARK(BM_mpmc_drain<uint64_t, /*kBatch=*/false>)->Arg(1);
+BENCHMARK(BM_mpmc_drain<uint64_t, /*kBatch=*/true>)->Arg(8)->Arg(64);
+
+static long voluntary_context_switches() {
+  rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  return usage.ru_nvcsw;
+}
+
+// A producer pushes bursts of items with pauses in between while consumers
+// block in pop(). Arg 0 wakes every waiting consumer as soon as its item is
+// written; otherwise wakeups are batched up to that many items or 50us.
+static void BM_mpmc_bursty_wakeups(benchmark::State& state) {
+  static constexpr int kNumConsumers = 4;
+  static constexpr int kBursts = 200;
+  static constexpr int kBurstSize = 64;
+  const size_t batch = state.range(0);
+
+  QueueOpts opts;
+  if (batch > 0) {
+    opts.set_wakeup_batching(batch, std::chrono::microseconds{50});
+  }
+
+  long switches = 0;
+  for (auto _ : state) {
+    MPMCQueue<uint32_t, 1024> queue{opts};
+    long before = voluntary_context_switches();
+    std::vector<std::thread> consumers;
+    for (int i = 0; i < kNumConsumers; i++) {
+      consumers.emplace_back([&]() {
+        uint64_t sum = 0;
+        for (uint32_t v; (v = queue.pop()) != 0;) {
+          sum += v;
+        }
+        benchmark::DoNotOptimize(sum);
+      });
+    }
+    for (int b = 0; b < kBursts; b++) {
+      for (int j = 0; j < kBurstSize; j++) {
+        queue.push(j + 1);
+      }
+      std::this_thread::sleep_for(std::chrono::microseconds{100});
+    }
+    for (int i = 0; i < kNumConsumers; i++) {
+      queue.push(0);
+    }
+    for (auto& t : consumers) {
+      t.join();
+    }
+    switches += voluntary_context_switches() - before;
+  }
+  state.SetItemsProcessed(state.iterations() * kBursts * kBurstSize);
+  state.counters["ctx_switches"] = benchmark::Counter(
+      switches, benchmark::Counter::kAvgIterations);
+}
+BENCHMARK(BM_mpmc_bursty_wakeups)
+    ->Arg(0)
+    ->Arg(16)
+    ->Unit(benchmark::kMillisecond)
+    ->UseRealTime();
+
+}  // namespace theta
+
+BENCHMARK_MAIN();
@@ -0,0 +1,75 @@
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+
+#include "theta/queue/mpmc-queue.h"
+
+namespace theta {
+
+// 1M 16-byte slots, a 16 MiB slot array.
+using LargeQueue = MPMCQueue<uint64_t, 1 << 20>;
+
+static QueueOpts startup_opts(const benchmark::State& state) {
+  QueueOpts opts;
+  if (state.range(0) > 0) {
+    opts.set_prefault(state.range(0));
+  }
+  opts.set_lock_memory(state.range(1));
+  return opts;
+}
+
+// The cost of constructing a large queue. Arg 0 is the number of prefault
+// threads (0 for none) and arg 1 whether the slot array is mlock()ed.
+static void BM_mpmc_construct(benchmark::State& state) {
+  const QueueOpts opts = startup_opts(state);
+  for (auto _ : state) {
+    auto queue = std::make_unique<LargeQueue>(opts);
+    benchmark::DoNotOptimize(queue.get());
+  }
+}
+BENCHMARK(BM_mpmc_construct)
+    ->Args({0, 0})
+    ->Args({1, 0})
+    ->Args({4, 0})
+    ->Args({1, 1})
+    ->Unit(benchmark::kMillisecond)
+    ->UseRealTime();
+
+// One pass of pushes through a freshly constructed queue, reporting the
+// slowest push. A push that lands on a page that is not resident yet pays
+// for the page fault.
+static void BM_mpmc_first_pass(benchmark::State& state) {
+  const QueueOpts opts = startup_opts(state);
+  int64_t max_push_ns = 0;
+  for (auto _ : state) {
+    state.PauseTiming();
+    auto queue = std::make_unique<LargeQueue>(opts);
+    state.ResumeTiming();
+
+    for (uint64_t i = 0; i < LargeQueue::capacity() - 1; i++) {
+      auto start = std::chrono::steady_clock::now();
+      queue->push(i);
+      auto elapsed = std::chrono::steady_clock::now() - start;
+      max_push_ns = std::max<int64_t>(
+          max_push_ns, std::chrono::nanoseconds{elapsed}.count());
+    }
+
+    state.PauseTiming();
+    queue.reset();
+    state.ResumeTiming();
+  }
+  state.SetItemsProcessed(state.iterations() * (LargeQueue::capacity() - 1));
+  state.counters["max_push_ns"] = max_push_ns;
+}
+BENCHMARK(BM_mpmc_first_pass)
+    ->Args({0, 0})
+    ->Args({4, 1})
+    ->Unit(benchmark::kMillisecond)
+    ->UseRealTime();
+
+}  // namespace theta
+
+BENCHMARK_MAIN();
@@ -0,0 +1,60 @@
+#include <benchmark/benchmark.h>
+
+#include <atomic>
+#include <mutex>
+#include <thread>
+
+#include "theta/queue/mpsc-queue.h"
+
+namespace theta {
+
+// Measures the producer-side cost of MPSCQueue::try_push with and without
+// asymmetric fences. The consumer only runs when a producer finds the queue
+// full, so almost all of the measured time is spent publishing.
+template <bool kAsymmetricFences>
+static void BM_mpsc_producer_push(benchmark::State& state) {
+  using QType = MPSCQueue<int*, kAsymmetricFences>;
+  static QType* queue;
+  static std::mutex consumer_mu;
+  static std::atomic<int64_t> drains;
+
+  if (state.thread_index() == 0) {
+    queue = new QType{QueueOpts{}.set_max_size(1 << 16)};
+    drains.store(0, std::memory_order::relaxed);
+  }
+
+  int foo;
+  for (auto _ : state) {
+    while (!queue->try_push(&foo)) {
+      std::unique_lock l{consumer_mu, std::try_to_lock};
+      if (l.owns_lock()) {
+        queue->drain_to([](int*) {});
+        drains.fetch_add(1, std::memory_order::relaxed);
+      } else {
+        std::this_thread::yield();
+      }
+    }
+  }
+
+  state.SetItemsProcessed(state.iterations());
+  if (state.thread_index() == 0) {
+    state.counters["drains"] = drains.load(std::memory_order::relaxed);
+    delete queue;
+  }
+}
+BENCHMARK_TEMPLATE(BM_mpsc_producer_push, /*kAsymmetricFences=*/false)
+    ->Threads(1)
+    ->Threads(2)
+    ->Threads(4)
+    ->Threads(8)
+    ->UseRealTime();
+BENCHMARK_TEMPLATE(BM_mpsc_producer_push, /*kAsymmetricFences=*/true)
+    ->Threads(1)
+    ->Threads(2)
+    ->Threads(4)
+    ->Threads(8)
+    ->UseRealTime();
+
+}  // namespace theta
+
+BENCHMARK_MAIN();
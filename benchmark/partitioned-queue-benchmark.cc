@@ -0,0 +1,75 @@
+#include <benchmark/benchmark.h>
+
+#include <atomic>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+#include "theta/queue/partitioned-queue.h"
+
+namespace theta {
+
+static constexpr size_t kNumPartitions = 16;
+static constexpr size_t kNumProducers = 2;
+static constexpr uint64_t kItemsPerProducer = 1 << 18;
+
+// Stands in for per-item work, so that adding consumers has something to
+// parallelize.
+static uint64_t process(uint64_t item) {
+  for (int i = 0; i < 64; i++) {
+    item = item * 6364136223846793005ULL + 1442695040888963407ULL;
+  }
+  return item;
+}
+
+// kNumProducers threads push items with random keys while state.range(0)
+// consumers drain the queue.
+static void BM_consumer_scaling(benchmark::State& state) {
+  const size_t num_consumers = state.range(0);
+  const uint64_t total = kNumProducers * kItemsPerProducer;
+
+  for (auto _ : state) {
+    PartitionedQueue<uint64_t> queue{kNumPartitions,
+                                     QueueOpts{}.set_max_size(1024)};
+    std::atomic<uint64_t> received{0};
+
+    std::vector<std::thread> threads;
+    for (size_t c = 0; c < num_consumers; c++) {
+      threads.emplace_back([&]() {
+        auto consumer = queue.join();
+        uint64_t sum = 0;
+        while (received.load(std::memory_order::relaxed) < total) {
+          size_t n = consumer.poll(
+              [&](uint64_t item) { sum += process(item); });
+          if (n == 0) {
+            std::this_thread::yield();
+          } else {
+            received.fetch_add(n, std::memory_order::relaxed);
+          }
+        }
+        benchmark::DoNotOptimize(sum);
+      });
+    }
+    for (size_t p = 0; p < kNumProducers; p++) {
+      threads.emplace_back([&, p]() {
+        for (uint64_t i = 1; i <= kItemsPerProducer; i++) {
+          queue.push(/*key=*/i * kNumProducers + p, i);
+        }
+      });
+    }
+    for (auto& t : threads) {
+      t.join();
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * total);
+}
+BENCHMARK(BM_consumer_scaling)
+    ->Arg(1)
+    ->Arg(2)
+    ->Arg(4)
+    ->Unit(benchmark::kMillisecond)
+    ->UseRealTime();
+
+}  // namespace theta
+
+BENCHMARK_MAIN();
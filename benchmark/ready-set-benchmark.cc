@@ -0,0 +1,77 @@
+#include <benchmark/benchmark.h>
+
+#include <cstdint>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include "theta/queue/mpsc-queue.h"
+#include "theta/queue/ready-set.h"
+
+namespace theta {
+
+static constexpr size_t kNumInboxes = 4096;
+
+// The baseline: the dispatcher probes every inbox.
+class ProbeAllInboxes {
+ public:
+  ProbeAllInboxes() {
+    for (size_t i = 0; i < kNumInboxes; i++) {
+      inboxes_.push_back(
+          std::make_unique<MPSCQueue<uint64_t>>(QueueOpts{}.set_max_size(16)));
+    }
+  }
+
+  bool try_push(size_t inbox, uint64_t val) {
+    return inboxes_[inbox]->try_push(val);
+  }
+
+  template <typename Fn>
+  size_t dispatch(Fn&& fn) {
+    size_t n = 0;
+    for (size_t i = 0; i < kNumInboxes; i++) {
+      while (auto val = inboxes_[i]->try_pop()) {
+        fn(i, *val);
+        n++;
+      }
+    }
+    return n;
+  }
+
+ private:
+  std::vector<std::unique_ptr<MPSCQueue<uint64_t>>> inboxes_;
+};
+
+class ReadySetInboxes : public InboxSet<uint64_t> {
+ public:
+  ReadySetInboxes()
+      : InboxSet<uint64_t>(kNumInboxes, QueueOpts{}.set_max_size(16)) {}
+};
+
+// Items land in state.range(0) random inboxes out of kNumInboxes, and the
+// dispatcher then serves every inbox with items. Only the dispatch is timed.
+template <typename Inboxes>
+static void BM_dispatch(benchmark::State& state) {
+  const size_t num_ready = state.range(0);
+  Inboxes inboxes;
+  std::mt19937_64 rng{1};
+  uint64_t sum = 0;
+
+  for (auto _ : state) {
+    state.PauseTiming();
+    for (size_t i = 0; i < num_ready; i++) {
+      inboxes.try_push(rng() % kNumInboxes, i + 1);
+    }
+    state.ResumeTiming();
+
+    inboxes.dispatch([&](size_t, uint64_t v) { sum += v; });
+  }
+  benchmark::DoNotOptimize(sum);
+  state.SetItemsProcessed(state.iterations() * num_ready);
+}
+BENCHMARK_TEMPLATE(BM_dispatch, ProbeAllInboxes)->Arg(1)->Arg(16)->Arg(256);
+BENCHMARK_TEMPLATE(BM_dispatch, ReadySetInboxes)->Arg(1)->Arg(16)->Arg(256);
+
+}  // namespace theta
+
+BENCHMARK_MAIN();
@@ -0,0 +1,108 @@
+#include <benchmark/benchmark.h>
+
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "theta/queue/mpmc-queue.h"
+#include "theta/queue/reorder-buffer.h"
+
+namespace theta {
+
+static constexpr uint64_t kNumItems = 1 << 18;
+
+// The baseline: finished items wait in a map under a mutex.
+class MutexMapReorder {
+ public:
+  void insert(uint64_t seq, uint64_t val) {
+    std::lock_guard lock{mu_};
+    done_.emplace(seq, val);
+  }
+
+  template <typename Fn>
+  size_t drain(Fn&& fn) {
+    std::lock_guard lock{mu_};
+    size_t n = 0;
+    for (auto it = done_.begin(); it != done_.end() && it->first == next_;
+         it = done_.erase(it)) {
+      fn(it->second);
+      next_++;
+      n++;
+    }
+    return n;
+  }
+
+ private:
+  std::mutex mu_;
+  std::map<uint64_t, uint64_t> done_;
+  uint64_t next_{0};
+};
+
+class LockFreeReorder : public ReorderBuffer<uint64_t, 4096> {};
+
+// One producer feeds state.range(0) workers through an MPMCQueue, and the
+// calling thread restores the original order.
+template <typename Reorder>
+static void BM_fan_out_fan_in(benchmark::State& state) {
+  const int num_workers = state.range(0);
+
+  for (auto _ : state) {
+    MPMCQueue<uint64_t, 4096> queue;
+    Reorder reorder;
+
+    std::vector<std::thread> threads;
+    for (int w = 0; w < num_workers; w++) {
+      threads.emplace_back([&]() {
+        while (true) {
+          uint64_t seq;
+          uint64_t item = queue.pop(&seq);
+          if (item == 0) {
+            return;
+          }
+          reorder.insert(seq, item);
+        }
+      });
+    }
+    threads.emplace_back([&]() {
+      for (uint64_t i = 1; i <= kNumItems; i++) {
+        queue.push(i);
+      }
+      for (int w = 0; w < num_workers; w++) {
+        queue.push(0);
+      }
+    });
+
+    uint64_t received = 0;
+    uint64_t sum = 0;
+    while (received < kNumItems) {
+      size_t n = reorder.drain([&](uint64_t v) { sum += v; });
+      if (n == 0) {
+        std::this_thread::yield();
+      }
+      received += n;
+    }
+    for (auto& t : threads) {
+      t.join();
+    }
+    benchmark::DoNotOptimize(sum);
+  }
+  state.SetItemsProcessed(state.iterations() * kNumItems);
+}
+BENCHMARK_TEMPLATE(BM_fan_out_fan_in, MutexMapReorder)
+    ->Arg(1)
+    ->Arg(2)
+    ->Arg(4)
+    ->Unit(benchmark::kMillisecond)
+    ->UseRealTime();
+BENCHMARK_TEMPLATE(BM_fan_out_fan_in, LockFreeReorder)
+    ->Arg(1)
+    ->Arg(2)
+    ->Arg(4)
+    ->Unit(benchmark::kMillisecond)
+    ->UseRealTime();
+
+}  // namespace theta
+
+BENCHMARK_MAIN();
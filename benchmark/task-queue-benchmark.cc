@@ -0,0 +1,133 @@
+#include <benchmark/benchmark.h>
+
+#include <atomic>
+#include <functional>
+#include <latch>
+#include <thread>
+#include <vector>
+
+#include "theta/queue/mpmc-queue.h"
+#include "theta/queue/task-queue.h"
+
+namespace theta {
+
+// The baseline: a heap-allocated std::function passed by pointer.
+class FunctionPointerPool {
+  using Task = std::function<void()>;
+
+ public:
+  explicit FunctionPointerPool(size_t num_workers) {
+    for (size_t i = 0; i < num_workers; i++) {
+      workers_.emplace_back([this]() {
+        while (Task* task = queue_.pop()) {
+          (*task)();
+          delete task;
+        }
+      });
+    }
+  }
+
+  ~FunctionPointerPool() {
+    for (size_t i = 0; i < workers_.size(); i++) {
+      queue_.push(nullptr);
+    }
+    for (auto& w : workers_) {
+      w.join();
+    }
+  }
+
+  template <typename F>
+  void submit(F&& f) {
+    queue_.push(new Task{std::forward<F>(f)});
+  }
+
+ private:
+  MPMCQueue<Task*, 1024> queue_;
+  std::vector<std::thread> workers_;
+};
+
+class InlineTaskPool {
+ public:
+  explicit InlineTaskPool(size_t num_workers) {
+    for (size_t i = 0; i < num_workers; i++) {
+      workers_.emplace_back([this]() {
+        while (true) {
+          auto task = queue_.pop();
+          if (stopping_.load(std::memory_order::relaxed)) {
+            return;
+          }
+          task();
+        }
+      });
+    }
+  }
+
+  ~InlineTaskPool() {
+    stopping_.store(true, std::memory_order::relaxed);
+    for (size_t i = 0; i < workers_.size(); i++) {
+      queue_.push([]() {});
+    }
+    for (auto& w : workers_) {
+      w.join();
+    }
+  }
+
+  template <typename F>
+  void submit(F&& f) {
+    queue_.push(std::forward<F>(f));
+  }
+
+ private:
+  TaskQueue<1024> queue_;
+  std::atomic<bool> stopping_{false};
+  std::vector<std::thread> workers_;
+};
+
+// Producers submit small tasks that each capture a few words; workers run
+// them. Measures submit plus execute throughput.
+template <typename Pool>
+static void BM_submit_execute(benchmark::State& state) {
+  const int num_producers = state.range(0);
+  const int num_workers = state.range(1);
+  static constexpr int kTasksPerProducer = 1 << 14;
+
+  Pool pool(num_workers);
+  for (auto _ : state) {
+    std::latch done{num_producers * kTasksPerProducer};
+    std::atomic<uint64_t> sum{0};
+    std::vector<std::thread> producers;
+    for (int p = 0; p < num_producers; p++) {
+      producers.emplace_back([&]() {
+        for (uint64_t i = 0; i < kTasksPerProducer; i++) {
+          pool.submit([&sum, &done, i, j = i * 3]() {
+            sum.fetch_add(i + j, std::memory_order::relaxed);
+            done.count_down();
+          });
+        }
+      });
+    }
+    for (auto& p : producers) {
+      p.join();
+    }
+    done.wait();
+    benchmark::DoNotOptimize(sum.load());
+  }
+  state.SetItemsProcessed(state.iterations() * num_producers
+                          * kTasksPerProducer);
+}
+BENCHMARK_TEMPLATE(BM_submit_execute, FunctionPointerPool)
+    ->Args({1, 1})
+    ->Args({2, 2})
+    ->Args({4, 4})
+    ->Unit(benchmark::kMillisecond)
+    ->UseRealTime();
+BENCHMARK_TEMPLATE(BM_submit_execute, InlineTaskPool)
+    ->Args({1, 1})
+    ->Args({2, 2})
+    ->Args({4, 4})
+    ->Unit(benchmark::kMillisecond)
+    ->UseRealTime();
+
+}  // namespace theta
+
+BENCHMARK_MAIN();
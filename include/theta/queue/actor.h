@@ -0,0 +1,170 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+#include "theta/queue/mpmc-queue.h"
+#include "theta/queue/mpsc-queue.h"
+
+namespace theta {
+
+class ActorScheduler;
+
+// The scheduling state shared by all actors, independent of message type.
+class ActorBase {
+ public:
+  virtual ~ActorBase() = default;
+
+ protected:
+  explicit ActorBase(ActorScheduler& scheduler) : scheduler_(scheduler) {}
+
+  // Called by a sender that moved the mailbox from empty to non-empty.
+  inline void activate();
+
+ private:
+  friend class ActorScheduler;
+
+  ActorScheduler& scheduler_;
+  // Set while the actor is in the run queue or running, so that it is
+  // enqueued at most once no matter how many senders race.
+  std::atomic<bool> scheduled_{false};
+
+  // Processes up to budget messages and returns the number processed.
+  virtual size_t run(size_t budget) = 0;
+  virtual bool has_messages() const = 0;
+};
+
+// The interface that actors use to make themselves runnable.
+class ActorScheduler {
+ public:
+  virtual ~ActorScheduler() = default;
+
+ protected:
+  friend class ActorBase;
+
+  virtual void enqueue(ActorBase* actor) = 0;
+
+  static size_t run(ActorBase* actor, size_t budget) {
+    return actor->run(budget);
+  }
+
+  // Returns true if the actor must be put back on the run queue.
+  static bool finish_activation(ActorBase* actor) {
+    if (actor->has_messages()) {
+      return true;
+    }
+    actor->scheduled_.store(false, std::memory_order::seq_cst);
+    std::atomic_thread_fence(std::memory_order::seq_cst);
+    // A sender that saw the flag still set relies on this re-check.
+    return actor->has_messages()
+        && !actor->scheduled_.exchange(true, std::memory_order::acq_rel);
+  }
+};
+
+// Runs actors on a fixed set of threads. An actor is placed on the run queue
+// when its mailbox goes from empty to non-empty, processes at most
+// messages_per_activation messages when it is dequeued, and then goes to the
+// back of the run queue if more messages are waiting.
+//
+// kRunQueueSize bounds the number of actors that can be runnable at once.
+template <size_t kRunQueueSize = 1 << 16>
+class BasicActorScheduler : public ActorScheduler {
+ public:
+  explicit BasicActorScheduler(
+      size_t num_workers = std::thread::hardware_concurrency(),
+      size_t messages_per_activation = 64)
+      : messages_per_activation_(messages_per_activation) {
+    if (num_workers == 0) {
+      num_workers = 1;
+    }
+    for (size_t i = 0; i < num_workers; i++) {
+      workers_.emplace_back([this]() { run_worker(); });
+    }
+  }
+
+  // Stops the workers once they reach the end of the run queue. Destroy the
+  // scheduler before the actors it runs, since a worker may still be finishing
+  // an activation after the last receive() returns.
+  ~BasicActorScheduler() override {
+    for (size_t i = 0; i < workers_.size(); i++) {
+      run_queue_.push(nullptr);
+    }
+    for (auto& w : workers_) {
+      w.join();
+    }
+  }
+
+ private:
+  const size_t messages_per_activation_;
+  MPMCQueue<ActorBase*, kRunQueueSize> run_queue_;
+  std::vector<std::thread> workers_;
+
+  void enqueue(ActorBase* actor) override { run_queue_.push(actor); }
+
+  void run_worker() {
+    while (ActorBase* actor = run_queue_.pop()) {
+      run(actor, messages_per_activation_);
+      if (finish_activation(actor)) {
+        run_queue_.push(actor);
+      }
+    }
+  }
+};
+
+using DefaultActorScheduler = BasicActorScheduler<>;
+
+void ActorBase::activate() {
+  if (!scheduled_.exchange(true, std::memory_order::acq_rel)) {
+    scheduler_.enqueue(this);
+  }
+}
+
+// An actor with an MPSCQueue mailbox. Subclasses implement receive(), which
+// is never called concurrently for the same actor. As with MPSCQueue, a
+// message must not be a "zero" value.
+template <ZeroableAtomType Msg>
+class Actor : public ActorBase {
+ public:
+  Actor(ActorScheduler& scheduler, size_t mailbox_size = 1024)
+      : ActorBase(scheduler)
+      , mailbox_(QueueOpts{}.set_max_size(mailbox_size)) {}
+
+  // Returns false if the mailbox is full.
+  bool send(Msg msg) {
+    size_t num_items;
+    if (!mailbox_.try_push(msg, &num_items)) {
+      return false;
+    }
+    // Only the sender that made the mailbox non-empty needs to schedule the
+    // actor. Any other sender found it queued, running, or about to re-check.
+    if (num_items == 1) {
+      activate();
+    }
+    return true;
+  }
+
+ protected:
+  virtual void receive(Msg msg) = 0;
+
+ private:
+  MPSCQueue<Msg> mailbox_;
+
+  size_t run(size_t budget) override {
+    size_t n = 0;
+    while (n < budget) {
+      auto msg = mailbox_.try_pop();
+      if (!msg) {
+        break;
+      }
+      receive(*msg);
+      n++;
+    }
+    return n;
+  }
+
+  bool has_messages() const override { return mailbox_.size() > 0; }
+};
+
+}  // namespace theta
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <linux/membarrier.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <atomic>
+
+namespace theta {
+
+namespace internal {
+
+inline bool register_private_expedited_membarrier() {
+  long cmds = syscall(SYS_membarrier, MEMBARRIER_CMD_QUERY, 0, 0);
+  if (cmds < 0 || (cmds & MEMBARRIER_CMD_PRIVATE_EXPEDITED) == 0) {
+    return false;
+  }
+  return syscall(SYS_membarrier,
+                 MEMBARRIER_CMD_REGISTER_PRIVATE_EXPEDITED,
+                 0,
+                 0)
+      == 0;
+}
+
+}  // namespace internal
+
+// Returns true if the process is registered for expedited private membarrier
+// commands. The first call performs the registration, so it should happen
+// before any thread relies on asymmetric_light_barrier().
+inline bool asymmetric_fences_supported() {
+  static const bool supported
+      = internal::register_private_expedited_membarrier();
+  return supported;
+}
+
+// The cheap half of an asymmetric fence pair. When membarrier is available
+// this only restrains the compiler; the matching asymmetric_heavy_barrier()
+// forces the hardware ordering onto every running thread of the process.
+inline void asymmetric_light_barrier() {
+  if (asymmetric_fences_supported()) {
+    std::atomic_signal_fence(std::memory_order::seq_cst);
+  } else {
+    std::atomic_thread_fence(std::memory_order::seq_cst);
+  }
+}
+
+// The expensive half of an asymmetric fence pair. If the caller has observed a
+// store that another thread made after an asymmetric_light_barrier(), then
+// once this returns the caller also observes every store that thread made
+// before that barrier.
+inline void asymmetric_heavy_barrier() {
+  if (asymmetric_fences_supported()) {
+    syscall(SYS_membarrier, MEMBARRIER_CMD_PRIVATE_EXPEDITED, 0, 0);
+  } else {
+    std::atomic_thread_fence(std::memory_order::seq_cst);
+  }
+}
+
+}  // namespace theta
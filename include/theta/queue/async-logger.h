@@ -0,0 +1,246 @@
+#pragma once
+
+#include <fmt/format.h>
+#include <limits.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+#include <thread>
+#include <tuple>
+#include <type_traits>
+#include <vector>
+
+#include "theta/queue/byte-ring.h"
+#include "theta/queue/queue-event.h"
+
+namespace theta {
+
+namespace internal {
+
+template <typename T>
+concept StringLogArg = std::is_convertible_v<const T&, std::string_view>;
+
+// Strings are copied into the record; everything else is stored by value.
+template <typename T>
+using StoredLogArg
+    = std::conditional_t<StringLogArg<T>, std::string_view, std::decay_t<T>>;
+
+template <typename T>
+size_t encoded_size(const T& v) {
+  if constexpr (StringLogArg<T>) {
+    return sizeof(uint32_t) + std::string_view{v}.size();
+  } else {
+    return sizeof(T);
+  }
+}
+
+template <typename T>
+void encode(std::byte*& out, const T& v) {
+  if constexpr (StringLogArg<T>) {
+    std::string_view sv{v};
+    uint32_t size = sv.size();
+    memcpy(out, &size, sizeof(size));
+    memcpy(out + sizeof(size), sv.data(), size);
+    out += sizeof(size) + size;
+  } else {
+    static_assert(std::is_trivially_copyable_v<T>,
+                  "Log arguments must be strings or trivially copyable");
+    memcpy(out, &v, sizeof(T));
+    out += sizeof(T);
+  }
+}
+
+template <typename T>
+StoredLogArg<T> decode(const std::byte*& in) {
+  if constexpr (StringLogArg<T>) {
+    uint32_t size;
+    memcpy(&size, in, sizeof(size));
+    std::string_view sv{reinterpret_cast<const char*>(in + sizeof(size)),
+                        size};
+    in += sizeof(size) + size;
+    return sv;
+  } else {
+    T v;
+    memcpy(&v, in, sizeof(T));
+    in += sizeof(T);
+    return v;
+  }
+}
+
+using LogFormatter = void (*)(fmt::memory_buffer& out,
+                              std::string_view format,
+                              const std::byte* args);
+
+template <typename... Args>
+void format_log_record(fmt::memory_buffer& out,
+                       std::string_view format,
+                       const std::byte* args) {
+  // Braced initialization decodes the arguments left to right.
+  std::tuple<StoredLogArg<Args>...> decoded{decode<Args>(args)...};
+  std::apply(
+      [&](const auto&... a) {
+        fmt::format_to(std::back_inserter(out), fmt::runtime(format), a...);
+      },
+      decoded);
+}
+
+// The fixed part of every log record; the encoded arguments follow it.
+struct LogRecordHeader {
+  LogFormatter formatter;
+  const char* format;
+  size_t format_size;
+};
+
+}  // namespace internal
+
+// A logger whose producers only copy their arguments. log() reserves a
+// record in an MPSCByteRing, stores the format string's address and the
+// arguments in binary form, and commits it. A background thread formats
+// committed records with fmt and writes them to the fd in batches with
+// writev(2).
+//
+// Format strings must have static storage duration, which string literals
+// do. If the ring is full, the record is dropped and counted rather than
+// blocking the caller.
+class AsyncLogger {
+ public:
+  explicit AsyncLogger(int fd = STDERR_FILENO, size_t buffer_size = 1 << 20)
+      : fd_(fd), ring_(buffer_size), writer_([this]() { run_writer(); }) {}
+
+  AsyncLogger(const AsyncLogger&) = delete;
+  AsyncLogger& operator=(const AsyncLogger&) = delete;
+
+  // Writes every committed record, then stops the writer thread.
+  ~AsyncLogger() {
+    stopping_.store(true, std::memory_order::seq_cst);
+    event_.notify();
+    writer_.join();
+  }
+
+  // Logs one line. Returns false if the record was dropped.
+  template <typename... Args>
+  bool log(fmt::format_string<Args...> format, Args&&... args) {
+    using Header = internal::LogRecordHeader;
+    size_t size = sizeof(Header) + (0 + ... + internal::encoded_size(args));
+
+    auto reservation = ring_.reserve(size);
+    if (!reservation) {
+      dropped_.fetch_add(1, std::memory_order::relaxed);
+      return false;
+    }
+
+    std::byte* out = reservation.payload().data();
+    fmt::string_view fmt_sv = format;
+    Header header{
+        .formatter = &internal::format_log_record<std::decay_t<Args>...>,
+        .format = fmt_sv.data(),
+        .format_size = fmt_sv.size(),
+    };
+    memcpy(out, &header, sizeof(header));
+    out += sizeof(header);
+    (internal::encode(out, args), ...);
+
+    ring_.commit(reservation);
+    event_.notify();
+    return true;
+  }
+
+  // Blocks until every record logged before the call has been written.
+  void flush() {
+    uint64_t target = ring_.reserved_end();
+    event_.notify();
+    while (written_end_.load(std::memory_order::acquire) < target) {
+      std::this_thread::yield();
+    }
+  }
+
+  uint64_t dropped() const { return dropped_.load(std::memory_order::relaxed); }
+
+ private:
+  const int fd_;
+  MPSCByteRing ring_;
+  QueueEvent event_;
+  std::atomic<bool> stopping_{false};
+  std::atomic<uint64_t> written_end_{0};
+  std::atomic<uint64_t> dropped_{0};
+  std::thread writer_;
+
+  void run_writer() {
+    fmt::memory_buffer out;
+    std::vector<size_t> line_ends;
+
+    while (true) {
+      out.clear();
+      line_ends.clear();
+      size_t n = ring_.consume([&](std::span<const std::byte> record) {
+        internal::LogRecordHeader header;
+        memcpy(&header, record.data(), sizeof(header));
+        header.formatter(out,
+                         std::string_view{header.format, header.format_size},
+                         record.data() + sizeof(header));
+        out.push_back('\n');
+        line_ends.push_back(out.size());
+      });
+
+      if (n > 0) {
+        write_lines(out, line_ends);
+        written_end_.store(ring_.consumed_end(), std::memory_order::release);
+        continue;
+      }
+
+      uint32_t epoch = event_.prepare_wait();
+      std::atomic_thread_fence(std::memory_order::seq_cst);
+      if (!ring_.empty()) {
+        // A reserved record that has not been committed yet.
+        event_.cancel_wait();
+        std::this_thread::yield();
+      } else if (stopping_.load(std::memory_order::seq_cst)) {
+        event_.cancel_wait();
+        return;
+      } else {
+        event_.wait(epoch);
+      }
+    }
+  }
+
+  void write_lines(const fmt::memory_buffer& out,
+                   const std::vector<size_t>& line_ends) {
+    std::vector<iovec> iov;
+    iov.reserve(line_ends.size());
+    size_t begin = 0;
+    for (size_t end : line_ends) {
+      iov.push_back(iovec{const_cast<char*>(out.data()) + begin, end - begin});
+      begin = end;
+    }
+
+    size_t i = 0;
+    while (i < iov.size()) {
+      int count = std::min<size_t>(iov.size() - i, IOV_MAX);
+      ssize_t written = writev(fd_, &iov[i], count);
+      if (written < 0) {
+        if (errno == EINTR) {
+          continue;
+        }
+        return;
+      }
+      // Skip fully written lines and trim a partially written one.
+      while (i < iov.size()
+             && static_cast<size_t>(written) >= iov[i].iov_len) {
+        written -= iov[i].iov_len;
+        i++;
+      }
+      if (written > 0) {
+        iov[i].iov_base = static_cast<char*>(iov[i].iov_base) + written;
+        iov[i].iov_len -= written;
+      }
+    }
+  }
+};
+
+}  // namespace theta
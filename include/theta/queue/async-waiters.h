@@ -0,0 +1,90 @@
+#pragma once
+
+#include <atomic>
+#include <concepts>
+#include <coroutine>
+
+#include "theta/queue/defs.h"
+
+namespace theta {
+
+// Anything that can run a suspended coroutine, e.g. a thread pool that queues
+// the handle or an event loop that resumes it on its own thread.
+template <typename E>
+concept CoroutineExecutor = requires(E& e, std::coroutine_handle<> h) {
+  e.schedule(h);
+};
+
+// Resumes the coroutine on whichever thread completed its operation.
+struct InlineExecutor {
+  void schedule(std::coroutine_handle<> h) { h.resume(); }
+};
+
+// A suspended operation parked in an AsyncWaiterList.
+class AsyncWaiter {
+ public:
+  virtual ~AsyncWaiter() = default;
+
+  // Attempts the operation without blocking. On success, the waiter hands its
+  // coroutine to its executor and must not be touched again by the caller.
+  virtual bool try_complete() = 0;
+
+ private:
+  friend class AsyncWaiterList;
+  AsyncWaiter* next_{nullptr};
+};
+
+// A lock-free set of parked waiters. Waiters are only ever removed all at once
+// by wake(), so pushing onto the list is immune to ABA.
+//
+// Correctness relies on a Dekker-style handshake: the side that makes the
+// queue ready must do so with a seq_cst operation before calling wake(), and
+// the is_ready predicate must read the queue state with seq_cst loads.
+class AsyncWaiterList {
+ public:
+  // Parks the waiter until a wake() completes it. If the queue became ready
+  // while parking, this wakes the list itself so that no wakeup is lost.
+  template <typename ReadyFn>
+  void park(AsyncWaiter* waiter, ReadyFn&& is_ready) {
+    push(waiter);
+    if (is_ready()) {
+      wake(is_ready);
+    }
+  }
+
+  // Retries parked waiters for as long as the queue is ready. Waiters that
+  // fail to complete are parked again.
+  template <typename ReadyFn>
+  void wake(ReadyFn&& is_ready) {
+    while (head_.load(std::memory_order::seq_cst) && is_ready()) {
+      AsyncWaiter* waiter = head_.exchange(nullptr, std::memory_order::acq_rel);
+      while (waiter) {
+        AsyncWaiter* next = waiter->next_;
+        if (!waiter->try_complete()) {
+          push(waiter);
+        }
+        waiter = next;
+      }
+    }
+  }
+
+  bool empty() const {
+    return head_.load(std::memory_order::seq_cst) == nullptr;
+  }
+
+ private:
+  alignas(hardware_destructive_interference_size)
+      std::atomic<AsyncWaiter*> head_{nullptr};
+
+  void push(AsyncWaiter* waiter) {
+    AsyncWaiter* head = head_.load(std::memory_order::relaxed);
+    do {
+      waiter->next_ = head;
+    } while (!head_.compare_exchange_weak(head,
+                                          waiter,
+                                          std::memory_order::seq_cst,
+                                          std::memory_order::relaxed));
+  }
+};
+
+}  // namespace theta
@@ -0,0 +1,123 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "theta/queue/queue-event.h"
+#include "theta/queue/wait-any.h"
+
+namespace theta {
+
+// Counters for the batches a Batcher has returned.
+struct BatchStats {
+  uint64_t num_batches = 0;
+  uint64_t num_items = 0;
+  // Batches that reached max_items.
+  uint64_t num_full = 0;
+  // Batches returned because their first item reached max_delay.
+  uint64_t num_timed_out = 0;
+  // From popping a batch's first item to returning the batch.
+  std::chrono::nanoseconds total_delay{0};
+  std::chrono::nanoseconds max_delay{0};
+
+  double mean_batch_size() const {
+    return num_batches ? static_cast<double>(num_items) / num_batches : 0.0;
+  }
+
+  std::chrono::nanoseconds mean_delay() const {
+    if (num_batches == 0) {
+      return std::chrono::nanoseconds{0};
+    }
+    return total_delay / static_cast<int64_t>(num_batches);
+  }
+};
+
+// Collects items from a queue into batches for sinks that do better with
+// batches, such as file writes, compression, or RPCs. A batch is returned
+// once it holds max_items items, or once max_delay has passed since its first
+// item was popped, whichever comes first. While the batch is short, the
+// batcher sleeps on the queue's ready_event() with a timeout instead of
+// polling.
+//
+// Several batchers may share an MPMCQueue. Each batcher is used by one thread
+// at a time.
+template <WaitableQueue Queue>
+class Batcher {
+ public:
+  using Item = typename decltype(std::declval<Queue&>().try_pop())::value_type;
+
+  Batcher(Queue& queue, size_t max_items, std::chrono::nanoseconds max_delay)
+      : queue_(queue), max_items_(max_items), max_delay_(max_delay) {}
+
+  // Replaces the contents of out with the next batch and returns its size.
+  // Returns 0 if no item arrives within max_wait.
+  size_t next_batch(
+      std::vector<Item>& out,
+      std::chrono::nanoseconds max_wait = std::chrono::nanoseconds::max()) {
+    using Clock = std::chrono::steady_clock;
+    out.clear();
+    const Clock::time_point start = Clock::now();
+    Clock::time_point first_item_at;
+
+    while (out.size() < max_items_) {
+      if (auto item = queue_.try_pop()) {
+        if (out.empty()) {
+          first_item_at = Clock::now();
+        }
+        out.push_back(*item);
+        continue;
+      }
+
+      std::chrono::nanoseconds remaining;
+      if (!out.empty()) {
+        remaining = max_delay_ - (Clock::now() - first_item_at);
+      } else if (max_wait != std::chrono::nanoseconds::max()) {
+        remaining = max_wait - (Clock::now() - start);
+      } else {
+        remaining = std::chrono::nanoseconds::max();
+      }
+      if (remaining <= std::chrono::nanoseconds::zero()) {
+        break;
+      }
+
+      QueueEvent& event = queue_.ready_event();
+      uint32_t epoch = event.prepare_wait();
+      if (queue_.poll_ready()) {
+        event.cancel_wait();
+      } else if (remaining == std::chrono::nanoseconds::max()) {
+        event.wait(epoch);
+      } else {
+        event.wait_for(epoch, remaining);
+      }
+    }
+
+    if (!out.empty()) {
+      auto delay = Clock::now() - first_item_at;
+      stats_.num_batches++;
+      stats_.num_items += out.size();
+      if (out.size() == max_items_) {
+        stats_.num_full++;
+      } else {
+        stats_.num_timed_out++;
+      }
+      stats_.total_delay += delay;
+      stats_.max_delay = std::max<std::chrono::nanoseconds>(stats_.max_delay,
+                                                            delay);
+    }
+    return out.size();
+  }
+
+  const BatchStats& stats() const { return stats_; }
+
+ private:
+  Queue& queue_;
+  const size_t max_items_;
+  const std::chrono::nanoseconds max_delay_;
+  BatchStats stats_;
+};
+
+}  // namespace theta
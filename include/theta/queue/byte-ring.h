@@ -0,0 +1,194 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <span>
+
+#include "theta/queue/defs.h"
+
+namespace theta {
+
+// Multiple-producer, single-consumer ring of variable-length records.
+//
+// A producer reserve()s space for a record, writes the payload in place, and
+// commit()s it; there is no per-record allocation. Records are consumed in
+// reservation order, so a reserved but uncommitted record holds back the ones
+// behind it until it is committed.
+//
+// Each record starts with an 8-byte header holding its payload size and a
+// committed bit. A record that would straddle the end of the buffer is
+// preceded by a padding record that fills the remainder, which limits a single
+// record to half of the capacity.
+class MPSCByteRing {
+  static constexpr uint64_t kHeaderSize = sizeof(uint64_t);
+  static constexpr uint64_t kCommittedFlag = 1;
+  static constexpr uint64_t kPaddingFlag = 2;
+
+ public:
+  class Reservation {
+   public:
+    Reservation() = default;
+
+    explicit operator bool() const { return header_ != nullptr; }
+
+    std::span<std::byte> payload() const {
+      return {reinterpret_cast<std::byte*>(header_ + 1), size_};
+    }
+
+   private:
+    friend class MPSCByteRing;
+
+    Reservation(uint64_t* header, size_t size) : header_(header), size_(size) {}
+
+    uint64_t* header_{nullptr};
+    size_t size_{0};
+  };
+
+  explicit MPSCByteRing(size_t capacity)
+      : capacity_(next_pow_2(capacity < 64 ? 64 : capacity))
+      , mask_(capacity_ - 1)
+      , buf_(new uint64_t[capacity_ / kHeaderSize]()) {}
+
+  size_t capacity() const { return capacity_; }
+
+  static size_t max_record_size(size_t capacity) {
+    return capacity / 2 - kHeaderSize;
+  }
+
+  // Reserves size bytes of payload. Returns an empty reservation if the ring
+  // does not have room.
+  Reservation reserve(size_t size) {
+    uint64_t len = round_up(size + kHeaderSize);
+    if (len > capacity_ / 2) {
+      return {};
+    }
+
+    uint64_t tail = tail_.load(std::memory_order::relaxed);
+    uint64_t need;
+    do {
+      uint64_t contiguous = capacity_ - (tail & mask_);
+      need = len <= contiguous ? len : contiguous + len;
+      if (tail + need - head_.load(std::memory_order::acquire) > capacity_) {
+        return {};
+      }
+      // seq_cst so that a consumer that re-checks empty() after
+      // QueueEvent::prepare_wait() cannot miss this reservation.
+    } while (!tail_.compare_exchange_weak(tail,
+                                          tail + need,
+                                          std::memory_order::seq_cst,
+                                          std::memory_order::relaxed));
+
+    if (need != len) {
+      uint64_t padding = need - len;
+      header_ref(header_at(tail))
+          .store(
+              ((padding - kHeaderSize) << 2) | kPaddingFlag | kCommittedFlag,
+              std::memory_order::release);
+      tail += padding;
+    }
+    return Reservation{header_at(tail), size};
+  }
+
+  void commit(const Reservation& r) {
+    assert(r);
+    header_ref(r.header_).store((r.size_ << 2) | kCommittedFlag,
+                                std::memory_order::release);
+  }
+
+  // Consumer only. Passes each committed record at the front of the ring to
+  // fn, in order, until it reaches an uncommitted record or the end. Returns
+  // the number of records consumed.
+  template <typename Fn>
+  size_t consume(Fn&& fn) {
+    uint64_t head = head_.load(std::memory_order::relaxed);
+    const uint64_t start = head;
+    const uint64_t tail = tail_.load(std::memory_order::acquire);
+    size_t n = 0;
+
+    while (head < tail) {
+      uint64_t header
+          = header_ref(header_at(head)).load(std::memory_order::acquire);
+      if ((header & kCommittedFlag) == 0) {
+        break;
+      }
+      uint64_t size = header >> 2;
+      if ((header & kPaddingFlag) == 0) {
+        fn(std::span<const std::byte>{
+            reinterpret_cast<const std::byte*>(header_at(head) + 1), size});
+        n++;
+      }
+      head += round_up(size + kHeaderSize);
+    }
+
+    if (head != start) {
+      // Producers rely on unused space being zero so that stale payload bytes
+      // never look like a committed header.
+      clear(start, head);
+      head_.store(head, std::memory_order::release);
+    }
+    return n;
+  }
+
+  // True if anything has been reserved and not yet consumed.
+  bool empty() const {
+    return head_.load(std::memory_order::acquire)
+        == tail_.load(std::memory_order::acquire);
+  }
+
+  // The position just past the last reservation, and just past the last
+  // consumed record. Every record reserved before a call to reserved_end()
+  // has been consumed once consumed_end() reaches that value.
+  uint64_t reserved_end() const {
+    return tail_.load(std::memory_order::acquire);
+  }
+  uint64_t consumed_end() const {
+    return head_.load(std::memory_order::acquire);
+  }
+
+ private:
+  const size_t capacity_;
+  const size_t mask_;
+  // Headers are accessed through std::atomic_ref; payloads are plain bytes
+  // published by the release store of their header.
+  std::unique_ptr<uint64_t[]> buf_;
+
+  alignas(hardware_destructive_interference_size)
+      std::atomic<uint64_t> head_{0};
+  alignas(hardware_destructive_interference_size)
+      std::atomic<uint64_t> tail_{0};
+
+  static constexpr size_t next_pow_2(size_t v) {
+    size_t p = 1;
+    while (p < v) {
+      p <<= 1;
+    }
+    return p;
+  }
+
+  static constexpr uint64_t round_up(uint64_t v) {
+    return (v + kHeaderSize - 1) & ~(kHeaderSize - 1);
+  }
+
+  uint64_t* header_at(uint64_t pos) const {
+    return &buf_[(pos & mask_) / kHeaderSize];
+  }
+
+  static std::atomic_ref<uint64_t> header_ref(uint64_t* header) {
+    return std::atomic_ref<uint64_t>{*header};
+  }
+
+  void clear(uint64_t begin, uint64_t end) {
+    while (begin < end) {
+      uint64_t offset = begin & mask_;
+      uint64_t n = std::min(end - begin, capacity_ - offset);
+      memset(&buf_[offset / kHeaderSize], 0, n);
+      begin += n;
+    }
+  }
+};
+
+}  // namespace theta
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <atomic>
+#include <bit>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+
+#include "theta/queue/defs.h"
+#include "theta/queue/mpmc-queue.h"
+
+namespace theta {
+
+// A work queue of keys in which a key is queued at most once. Pushing a key
+// that is already waiting is a no-op, so a burst of "recompute key" signals
+// costs one pass, and the queue never holds more than kNumKeys entries.
+//
+// Keys are dense indices below kNumKeys, such as the ids of table entries.
+// Each key has a pending bit. push() sets it and queues the key only if it
+// was clear; a pop clears it before returning the key, so a push that races
+// with the consumer's processing queues the key again rather than being
+// lost. A push for a pending key only reads its bit.
+template <size_t kNumKeys>
+class CoalescingQueue {
+  static constexpr size_t kNumWords = (kNumKeys + 63) / 64;
+
+ public:
+  CoalescingQueue() = default;
+  CoalescingQueue(const CoalescingQueue&) = delete;
+  CoalescingQueue& operator=(const CoalescingQueue&) = delete;
+
+  // Queues key unless it is already pending. Returns true if the key was
+  // queued. Any change that the caller made before push() is visible to the
+  // consumer that pops the key, whether or not this push queued it.
+  bool push(uint32_t key) {
+    assert(key < kNumKeys);
+    std::atomic<uint64_t>& word = pending_[key / 64];
+    const uint64_t bit = uint64_t{1} << (key % 64);
+    // Pairs with the fence in take(): either the consumer's processing sees
+    // the caller's change, or this load sees the cleared bit.
+    std::atomic_thread_fence(std::memory_order::seq_cst);
+    if (word.load(std::memory_order::relaxed) & bit) {
+      return false;
+    }
+    if (word.fetch_or(bit, std::memory_order::acq_rel) & bit) {
+      return false;
+    }
+    // At most kNumKeys keys are queued, so this never waits for space.
+    queue_.push(key);
+    return true;
+  }
+
+  std::optional<uint32_t> try_pop() {
+    auto key = queue_.try_pop();
+    if (key) {
+      take(*key);
+    }
+    return key;
+  }
+
+  // Blocks until a key is queued.
+  uint32_t pop() {
+    uint32_t key = queue_.pop();
+    take(key);
+    return key;
+  }
+
+  bool is_pending(uint32_t key) const {
+    return pending_[key / 64].load(std::memory_order::acquire)
+         & (uint64_t{1} << (key % 64));
+  }
+
+  size_t size() const { return queue_.size(); }
+
+ private:
+  MPMCQueue<uint32_t, std::bit_ceil(kNumKeys)> queue_;
+  std::atomic<uint64_t> pending_[kNumWords] = {};
+
+  void take(uint32_t key) {
+    pending_[key / 64].fetch_and(~(uint64_t{1} << (key % 64)),
+                                 std::memory_order::seq_cst);
+    std::atomic_thread_fence(std::memory_order::seq_cst);
+  }
+};
+
+}  // namespace theta
@@ -0,0 +1,193 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+
+#include "theta/queue/defs.h"
+#include "theta/queue/mpmc-queue.h"
+#include "theta/queue/queue-opts.h"
+
+namespace theta {
+
+// An MPMCQueue of 32-bit items, such as MessageSlab handles, that keeps
+// latency bounded under overload with CoDel (RFC 8289). Each item is stamped
+// with the time of its push, and the consumer measures how long it sat in
+// the queue. Once that has stayed above QueueOpts::codel_target() for a full
+// codel_interval(), items are dropped from the head at a rate that grows
+// with the square root of the number of drops, until an item comes through
+// under the target. A queue that is merely busy, with short bursts, is left
+// alone.
+//
+// Dropped items are passed to the on_drop argument of try_pop() so that the
+// caller can release them. With QueueOpts::set_codel(..., /*reject=*/true),
+// pushes also fail while the queue is dropping, so producers shed load at
+// the door.
+//
+// The timestamp takes the upper half of each 64-bit slot word, in
+// microseconds modulo 2^32, so sojourn times up to about 71 minutes are
+// measured correctly. Pushes may come from any thread; try_pop() is called
+// by one thread at a time.
+template <size_t kBufferSize = 128>
+class CoDelQueue {
+ public:
+  CoDelQueue() : CoDelQueue(QueueOpts{}) {}
+  explicit CoDelQueue(const QueueOpts& opts)
+      : queue_(opts)
+      , target_us_(opts.codel_target().count())
+      , interval_us_(opts.codel_interval().count())
+      , reject_(opts.codel_reject()) {}
+
+  // Returns false if the queue is full, or if it is dropping and rejection
+  // is enabled.
+  bool try_push(uint32_t item) {
+    if (rejecting()) {
+      return false;
+    }
+    return queue_.try_push(stamp(item));
+  }
+
+  // Waits for space. Returns false only if the push was rejected.
+  bool push(uint32_t item) {
+    if (rejecting()) {
+      return false;
+    }
+    queue_.push(stamp(item));
+    return true;
+  }
+
+  // Returns the next item that CoDel lets through, passing any items it
+  // drops on the way to on_drop. Returns nothing once the queue is empty.
+  template <typename OnDrop>
+  std::optional<uint32_t> try_pop(OnDrop&& on_drop) {
+    const uint64_t now = now_us();
+    Dequeued d = dequeue(now);
+
+    if (dropping_.load(std::memory_order::relaxed)) {
+      if (!d.ok_to_drop) {
+        dropping_.store(false, std::memory_order::relaxed);
+      }
+      while (d.ok_to_drop && now >= drop_next_us_) {
+        drop(*d.item, on_drop);
+        count_++;
+        d = dequeue(now);
+        if (!d.ok_to_drop) {
+          dropping_.store(false, std::memory_order::relaxed);
+        } else {
+          drop_next_us_ = control_law(drop_next_us_);
+        }
+      }
+    } else if (d.ok_to_drop) {
+      drop(*d.item, on_drop);
+      d = dequeue(now);
+      dropping_.store(true, std::memory_order::relaxed);
+      // Resume near the previous drop rate if dropping stopped only
+      // recently. The next drop may have been scheduled after now, so the
+      // difference is signed.
+      uint32_t delta = count_ - last_count_;
+      const bool recent = static_cast<int64_t>(now - drop_next_us_)
+                        < static_cast<int64_t>(16 * interval_us_);
+      count_ = delta > 1 && recent ? delta : 1;
+      drop_next_us_ = control_law(now);
+      last_count_ = count_;
+    }
+    return d.item;
+  }
+
+  std::optional<uint32_t> try_pop() {
+    return try_pop([](uint32_t) {});
+  }
+
+  // True while the consumer is dropping items.
+  bool dropping() const { return dropping_.load(std::memory_order::relaxed); }
+
+  uint64_t num_dropped() const {
+    return num_dropped_.load(std::memory_order::relaxed);
+  }
+
+  uint64_t num_rejected() const {
+    return num_rejected_.load(std::memory_order::relaxed);
+  }
+
+  size_t size() const { return queue_.size(); }
+
+ private:
+  struct Dequeued {
+    std::optional<uint32_t> item;
+    bool ok_to_drop{false};
+  };
+
+  MPMCQueue<uint64_t, kBufferSize> queue_;
+  const uint64_t target_us_;
+  const uint64_t interval_us_;
+  const bool reject_;
+  // Read by producers when reject_ is set.
+  alignas(hardware_destructive_interference_size)
+      std::atomic<bool> dropping_{false};
+  std::atomic<uint64_t> num_dropped_{0};
+  std::atomic<uint64_t> num_rejected_{0};
+  // Consumer state.
+  uint64_t first_above_us_{0};
+  uint64_t drop_next_us_{0};
+  uint32_t count_{0};
+  uint32_t last_count_{0};
+
+  static uint64_t now_us() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+  }
+
+  static uint64_t stamp(uint32_t item) {
+    return (now_us() << 32) | item;
+  }
+
+  bool rejecting() {
+    if (reject_ && dropping_.load(std::memory_order::relaxed)) {
+      num_rejected_.fetch_add(1, std::memory_order::relaxed);
+      return true;
+    }
+    return false;
+  }
+
+  template <typename OnDrop>
+  void drop(uint32_t item, OnDrop& on_drop) {
+    num_dropped_.fetch_add(1, std::memory_order::relaxed);
+    on_drop(item);
+  }
+
+  uint64_t control_law(uint64_t t) const {
+    return t + static_cast<uint64_t>(interval_us_ / std::sqrt(count_));
+  }
+
+  // Pops one item and decides whether CoDel may drop it: its sojourn time
+  // and every one since first_above_us_ - interval_us_ were above target.
+  Dequeued dequeue(uint64_t now) {
+    auto word = queue_.try_pop();
+    if (!word) {
+      first_above_us_ = 0;
+      return {};
+    }
+    Dequeued d{.item = static_cast<uint32_t>(*word)};
+    // An item stamped after now was pushed while this pop ran, so the
+    // difference is signed and clamped at zero.
+    const int32_t diff_us = static_cast<int32_t>(
+        static_cast<uint32_t>(now) - static_cast<uint32_t>(*word >> 32));
+    const uint32_t sojourn_us = std::max(diff_us, 0);
+    // An item that leaves the queue empty is not a standing queue.
+    if (sojourn_us < target_us_ || queue_.size() == 0) {
+      first_above_us_ = 0;
+    } else if (first_above_us_ == 0) {
+      first_above_us_ = now + interval_us_;
+    } else if (now >= first_above_us_) {
+      d.ok_to_drop = true;
+    }
+    return d;
+  }
+};
+
+}  // namespace theta
@@ -0,0 +1,171 @@
+#pragma once
+
+#include <atomic>
+#include <bit>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "theta/queue/defs.h"
+#include "theta/queue/spsc-ring.h"
+
+namespace theta {
+
+// Messaging between the cores of a thread-per-core program, where each core
+// runs one thread that owns its share of the state and every core may send to
+// every other one.
+//
+// Each ordered pair of cores has its own SPSCRing, so no index is shared by
+// more than one sender and one receiver, and a ring's cache lines move only
+// between those two cores. Messages are staged in a per-destination batch of
+// up to kBatchSize on the sending core and published together. Each core also
+// has a bitmap of the senders whose rings may hold messages for it, so its
+// poll loop visits only those rings instead of all num_cores of them.
+//
+// A core's thread calls send() to stage messages and poll() in its loop;
+// poll() publishes the core's staged batches before reading its own rings.
+template <typename T, size_t kRingCapacity = 256, size_t kBatchSize = 16>
+class CoreMesh {
+  struct Channel {
+    SPSCRing<T, kRingCapacity> ring;
+    // Sender side only.
+    alignas(hardware_destructive_interference_size) T pending[kBatchSize];
+    size_t num_pending{0};
+    // Set while dst is listed in the sender's Outbox.
+    bool in_dirty{false};
+  };
+
+  // The destinations that a core has staged messages for.
+  struct alignas(hardware_destructive_interference_size) Outbox {
+    std::vector<uint32_t> dirty;
+  };
+
+ public:
+  explicit CoreMesh(size_t num_cores)
+      : num_cores_(num_cores)
+      , words_per_core_((num_cores + 63) / 64)
+      , channels_(new Channel[num_cores * num_cores])
+      , outboxes_(new Outbox[num_cores])
+      , ready_(new ReadyWord[num_cores * words_per_core_]) {
+    assert(num_cores > 0);
+  }
+
+  CoreMesh(const CoreMesh&) = delete;
+  CoreMesh& operator=(const CoreMesh&) = delete;
+
+  size_t num_cores() const { return num_cores_; }
+
+  // Called only by core src. Stages msg for dst and publishes dst's batch once
+  // it is full. Returns false, without taking msg, if the batch is full and
+  // dst's ring has no room for any of it; the caller should poll() and retry.
+  bool send(size_t src, size_t dst, T msg) {
+    Channel& ch = channel(src, dst);
+    if (ch.num_pending == kBatchSize && publish(src, dst) == 0) {
+      return false;
+    }
+    // A batch that publish() moved out whole leaves dst listed, so the
+    // flag, rather than num_pending, says whether to list it.
+    if (!ch.in_dirty) {
+      outboxes_[src].dirty.push_back(dst);
+      ch.in_dirty = true;
+    }
+    ch.pending[ch.num_pending++] = std::move(msg);
+    if (ch.num_pending == kBatchSize) {
+      publish(src, dst);
+    }
+    return true;
+  }
+
+  // Called only by core src. Publishes every staged message that fits in its
+  // ring. Returns true if nothing is left staged.
+  bool flush(size_t src) {
+    auto& dirty = outboxes_[src].dirty;
+    size_t kept = 0;
+    for (uint32_t dst : dirty) {
+      Channel& ch = channel(src, dst);
+      publish(src, dst);
+      if (ch.num_pending > 0) {
+        dirty[kept++] = dst;
+      } else {
+        ch.in_dirty = false;
+      }
+    }
+    dirty.resize(kept);
+    return kept == 0;
+  }
+
+  // Called only by core dst. Flushes dst's own staged messages, then passes
+  // up to budget incoming messages to fn(src, msg), taking each sender's
+  // messages in order. Returns the number of messages passed.
+  template <typename Fn>
+  size_t poll(size_t dst, Fn&& fn, size_t budget = SIZE_MAX) {
+    flush(dst);
+
+    size_t total = 0;
+    for (size_t w = 0; w < words_per_core_ && total < budget; w++) {
+      std::atomic<uint64_t>& word = ready_[dst * words_per_core_ + w].bits;
+      if (word.load(std::memory_order::relaxed) == 0) {
+        continue;
+      }
+      // Clearing the bits before reading the rings pairs with the fence in
+      // publish(): a sender either sees its bit cleared and sets it again,
+      // or published before this exchange and its messages are read below.
+      uint64_t bits = word.exchange(0, std::memory_order::seq_cst);
+      for (; bits; bits &= bits - 1) {
+        size_t src = w * 64 + std::countr_zero(bits);
+        auto& ring = channel(src, dst).ring;
+        if (total < budget) {
+          total += ring.consume(
+              [&](T& msg) { fn(src, msg); }, budget - total);
+        }
+        if (!ring.empty()) {
+          word.fetch_or(bits & -bits, std::memory_order::relaxed);
+        }
+      }
+    }
+    return total;
+  }
+
+ private:
+  struct alignas(hardware_destructive_interference_size) ReadyWord {
+    std::atomic<uint64_t> bits{0};
+  };
+
+  const size_t num_cores_;
+  const size_t words_per_core_;
+  std::unique_ptr<Channel[]> channels_;
+  std::unique_ptr<Outbox[]> outboxes_;
+  // words_per_core_ words per destination; bit src is set while src's ring to
+  // that destination may be non-empty.
+  std::unique_ptr<ReadyWord[]> ready_;
+
+  Channel& channel(size_t src, size_t dst) {
+    assert(src < num_cores_ && dst < num_cores_);
+    return channels_[src * num_cores_ + dst];
+  }
+
+  // Moves as much of the staged batch as fits into the ring and returns the
+  // number of messages moved.
+  size_t publish(size_t src, size_t dst) {
+    Channel& ch = channel(src, dst);
+    size_t n = ch.ring.try_push_n(ch.pending, ch.num_pending);
+    if (n == 0) {
+      return 0;
+    }
+    std::move(ch.pending + n, ch.pending + ch.num_pending, ch.pending);
+    ch.num_pending -= n;
+
+    std::atomic_thread_fence(std::memory_order::seq_cst);
+    std::atomic<uint64_t>& word = ready_[dst * words_per_core_ + src / 64].bits;
+    const uint64_t bit = uint64_t{1} << (src % 64);
+    if ((word.load(std::memory_order::relaxed) & bit) == 0) {
+      word.fetch_or(bit, std::memory_order::release);
+    }
+    return n;
+  }
+};
+
+}  // namespace theta
@@ -0,0 +1,217 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "theta/queue/defs.h"
+
+namespace theta {
+
+// Epoch-based reclamation for objects that are passed around by pointer.
+//
+// A thread that dereferences a shared pointer does so while holding a Guard
+// from pin(). A thread that unlinks an object (for instance, the consumer that
+// popped it from a queue) calls retire() instead of delete. Retired objects
+// are kept on a per-thread list and freed in batches once the global epoch has
+// advanced twice past the epoch they were retired in, at which point no Guard
+// that could have observed them is still held.
+//
+// Retiring is a vector append, so it keeps the delete off the consumer's hot
+// path. Guards nest, and pinning an already pinned thread is only a counter
+// increment.
+//
+// The domain must outlive every thread's use of it. Objects that are still
+// retired when the domain is destroyed are freed by its destructor.
+class EpochDomain {
+  struct Retired {
+    void* ptr;
+    void (*deleter)(void*);
+    uint64_t epoch;
+  };
+
+  struct Participant {
+    // (epoch << 1) | 1 while pinned, 0 while quiescent.
+    alignas(hardware_destructive_interference_size)
+        std::atomic<uint64_t> state{0};
+    std::atomic<bool> in_use{false};
+    uint32_t nesting{0};
+    std::vector<Retired> retired;
+  };
+
+ public:
+  // The number of retired objects a thread accumulates before it tries to
+  // advance the epoch and free a batch.
+  static constexpr size_t kCollectThreshold = 64;
+
+  class Guard {
+   public:
+    Guard(Guard&& other) : participant_(other.participant_) {
+      other.participant_ = nullptr;
+    }
+    Guard(const Guard&) = delete;
+    Guard& operator=(const Guard&) = delete;
+    Guard& operator=(Guard&&) = delete;
+
+    ~Guard() {
+      if (participant_ && --participant_->nesting == 0) {
+        participant_->state.store(0, std::memory_order::release);
+      }
+    }
+
+   private:
+    friend class EpochDomain;
+
+    explicit Guard(Participant* participant) : participant_(participant) {}
+
+    Participant* participant_;
+  };
+
+  EpochDomain() : id_(next_id_.fetch_add(1, std::memory_order::relaxed)) {}
+
+  EpochDomain(const EpochDomain&) = delete;
+  EpochDomain& operator=(const EpochDomain&) = delete;
+
+  ~EpochDomain() {
+    for (auto& participant : participants_) {
+      for (const Retired& r : participant->retired) {
+        r.deleter(r.ptr);
+      }
+      participant->retired.clear();
+    }
+  }
+
+  // A process-wide domain for callers that do not need their own.
+  static EpochDomain& global() {
+    static EpochDomain domain;
+    return domain;
+  }
+
+  // Pointers loaded from shared locations while the returned Guard is alive
+  // stay valid until it is destroyed, even if they are retired meanwhile.
+  [[nodiscard]] Guard pin() {
+    Participant* participant = local_participant();
+    if (participant->nesting++ == 0) {
+      uint64_t epoch = epoch_.load(std::memory_order::relaxed);
+      participant->state.store((epoch << 1) | 1, std::memory_order::relaxed);
+      // Publishes the pinned state before any shared pointer is read. If the
+      // epoch advanced in the meantime, the stale value only holds back the
+      // next advance.
+      std::atomic_thread_fence(std::memory_order::seq_cst);
+    }
+    return Guard{participant};
+  }
+
+  // Frees ptr with delete once no Guard can still observe it. The object must
+  // already be unreachable for threads that pin after this call.
+  template <typename T>
+  void retire(T* ptr) {
+    retire(ptr, [](void* p) { delete static_cast<T*>(p); });
+  }
+
+  void retire(void* ptr, void (*deleter)(void*)) {
+    Participant* participant = local_participant();
+    participant->retired.push_back(
+        Retired{ptr, deleter, epoch_.load(std::memory_order::seq_cst)});
+    if (participant->retired.size() >= kCollectThreshold) {
+      collect();
+    }
+  }
+
+  // Tries to advance the epoch and frees this thread's retired objects that
+  // are old enough. Returns the number freed.
+  size_t collect() {
+    try_advance();
+    uint64_t epoch = epoch_.load(std::memory_order::acquire);
+
+    // Objects are retired in epoch order, so the reclaimable ones form a
+    // prefix of the list.
+    auto& retired = local_participant()->retired;
+    size_t n = 0;
+    while (n < retired.size() && retired[n].epoch + 2 <= epoch) {
+      retired[n].deleter(retired[n].ptr);
+      n++;
+    }
+    retired.erase(retired.begin(), retired.begin() + n);
+    return n;
+  }
+
+  uint64_t epoch() const { return epoch_.load(std::memory_order::acquire); }
+
+ private:
+  // Thread-local participants are looked up by domain id rather than address
+  // so that a domain allocated where a destroyed one used to be does not pick
+  // up stale entries.
+  struct LocalParticipant {
+    uint64_t domain_id;
+    std::shared_ptr<Participant> participant;
+  };
+
+  struct LocalParticipants {
+    std::vector<LocalParticipant> entries;
+
+    ~LocalParticipants() {
+      // Anything still retired is freed by the next thread that takes over
+      // the participant, or by the domain's destructor.
+      for (auto& entry : entries) {
+        entry.participant->in_use.store(false, std::memory_order::release);
+      }
+    }
+  };
+
+  static inline std::atomic<uint64_t> next_id_{0};
+  static inline thread_local LocalParticipants local_participants_;
+
+  const uint64_t id_;
+  alignas(hardware_destructive_interference_size)
+      std::atomic<uint64_t> epoch_{0};
+  std::mutex participants_mu_;
+  std::vector<std::shared_ptr<Participant>> participants_;
+
+  Participant* local_participant() {
+    for (auto& entry : local_participants_.entries) {
+      if (entry.domain_id == id_) {
+        return entry.participant.get();
+      }
+    }
+    auto participant = acquire_participant();
+    local_participants_.entries.push_back({id_, participant});
+    return participant.get();
+  }
+
+  std::shared_ptr<Participant> acquire_participant() {
+    std::lock_guard lock{participants_mu_};
+    for (auto& participant : participants_) {
+      bool expected = false;
+      if (participant->in_use.compare_exchange_strong(
+              expected, true, std::memory_order::acquire)) {
+        return participant;
+      }
+    }
+    auto participant = std::make_shared<Participant>();
+    participant->in_use.store(true, std::memory_order::relaxed);
+    participants_.push_back(participant);
+    return participant;
+  }
+
+  // The epoch advances only once every pinned thread has observed the
+  // current one.
+  void try_advance() {
+    uint64_t epoch = epoch_.load(std::memory_order::seq_cst);
+    {
+      std::lock_guard lock{participants_mu_};
+      for (auto& participant : participants_) {
+        uint64_t state = participant->state.load(std::memory_order::seq_cst);
+        if ((state & 1) && (state >> 1) != epoch) {
+          return;
+        }
+      }
+    }
+    epoch_.compare_exchange_strong(
+        epoch, epoch + 1, std::memory_order::seq_cst);
+  }
+};
+
+}  // namespace theta
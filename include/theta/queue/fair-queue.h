@@ -0,0 +1,212 @@
+#pragma once
+
+#include <atomic>
+#include <bit>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <thread>
+#include <vector>
+
+#include "theta/queue/defs.h"
+#include "theta/queue/mpsc-queue.h"
+#include "theta/queue/queue-event.h"
+#include "theta/queue/queue-opts.h"
+
+namespace theta {
+
+// A queue shared by several tenants that consumers serve in weighted
+// round-robin, so that a tenant that pushes heavily cannot starve the others
+// the way it can in one global FIFO.
+//
+// Each tenant has its own MPSCQueue and a weight. Dequeueing is deficit
+// round-robin with a cost of one per item: a tenant that the cursor reaches
+// with no deficit gets its weight as a deficit, and it is served until the
+// deficit runs out or its queue is empty, at which point the deficit is
+// dropped and the cursor moves on. Tenants with items are marked in a bitmap,
+// so finding the next one skips idle tenants a word at a time.
+//
+// Several consumers may pop at once. Since each tenant's queue has a single
+// consumer, a consumer claims a tenant in a second bitmap for the length of
+// one pop, and the others skip claimed tenants. A tenant whose turn is cut
+// short by another consumer moving the cursor keeps the rest of its deficit
+// for its next turn.
+template <ZeroableAtomType T>
+class FairQueue {
+  static constexpr size_t kNone = SIZE_MAX;
+
+ public:
+  // One tenant per weight. Each tenant's queue is created with opts.
+  FairQueue(std::vector<uint32_t> weights, QueueOpts opts)
+      : weights_(std::move(weights))
+      , deficits_(weights_.size(), 0)
+      , ready_(new std::atomic<uint64_t>[(weights_.size() + 63) / 64])
+      , claimed_(new std::atomic<uint64_t>[(weights_.size() + 63) / 64]) {
+    for (size_t i = 0; i < weights_.size(); i++) {
+      assert(weights_[i] > 0);
+      queues_.push_back(std::make_unique<MPSCQueue<T>>(opts));
+    }
+    for (size_t w = 0; w < num_words(); w++) {
+      ready_[w].store(0, std::memory_order::relaxed);
+      claimed_[w].store(0, std::memory_order::relaxed);
+    }
+  }
+
+  FairQueue(const FairQueue&) = delete;
+  FairQueue& operator=(const FairQueue&) = delete;
+
+  size_t num_tenants() const { return queues_.size(); }
+
+  // Returns false if the tenant's queue is full.
+  bool try_push(size_t tenant, T val) {
+    size_t num_items;
+    if (!queues_[tenant]->try_push(val, &num_items)) {
+      return false;
+    }
+    if (num_items == 1) {
+      mark_ready(tenant);
+    }
+    return true;
+  }
+
+  // Returns nothing if every tenant is idle or claimed by another consumer.
+  std::optional<T> try_pop() {
+    while (true) {
+      const size_t tenant = claim_next_ready();
+      if (tenant == kNone) {
+        return {};
+      }
+
+      if (deficits_[tenant] == 0) {
+        deficits_[tenant] = weights_[tenant];
+      }
+      auto val = queues_[tenant]->try_pop();
+      if (val) {
+        if (--deficits_[tenant] == 0) {
+          advance(tenant);
+        }
+      } else {
+        deficits_[tenant] = 0;
+        mark_idle(tenant);
+        advance(tenant);
+      }
+      release(tenant);
+      if (val) {
+        return val;
+      }
+    }
+  }
+
+  // Blocks until an item is available.
+  T pop() {
+    while (true) {
+      if (auto val = try_pop()) {
+        return *val;
+      }
+      uint32_t epoch = ready_event_.prepare_wait();
+      if (any_ready()) {
+        ready_event_.cancel_wait();
+        // The only marked tenants may be claimed for a moment.
+        std::this_thread::yield();
+        continue;
+      }
+      ready_event_.wait(epoch);
+    }
+  }
+
+  // The number of items waiting from tenant.
+  size_t size(size_t tenant) const { return queues_[tenant]->size(); }
+
+ private:
+  std::vector<std::unique_ptr<MPSCQueue<T>>> queues_;
+  const std::vector<uint32_t> weights_;
+  // deficits_[i] belongs to whichever consumer has claimed tenant i.
+  std::vector<uint64_t> deficits_;
+  std::atomic<size_t> cursor_{0};
+  // Bit i is set while tenant i may have items.
+  std::unique_ptr<std::atomic<uint64_t>[]> ready_;
+  // Bit i is set while a consumer is popping from tenant i.
+  std::unique_ptr<std::atomic<uint64_t>[]> claimed_;
+  QueueEvent ready_event_;
+
+  size_t num_words() const { return (queues_.size() + 63) / 64; }
+
+  void mark_ready(size_t tenant) {
+    // seq_cst so that a consumer that re-checks any_ready() after
+    // QueueEvent::prepare_wait() cannot miss this.
+    uint64_t old = ready_[tenant / 64].fetch_or(uint64_t{1} << (tenant % 64),
+                                                std::memory_order::seq_cst);
+    if (!(old & (uint64_t{1} << (tenant % 64)))) {
+      ready_event_.notify();
+    }
+  }
+
+  // Pushes that found the queue non-empty relied on the tenant staying
+  // marked, so re-mark it if an item arrived before the bit was cleared.
+  void mark_idle(size_t tenant) {
+    ready_[tenant / 64].fetch_and(~(uint64_t{1} << (tenant % 64)),
+                                  std::memory_order::seq_cst);
+    if (queues_[tenant]->size() > 0) {
+      mark_ready(tenant);
+    }
+  }
+
+  // The first marked, unclaimed tenant at or after the cursor, claimed.
+  size_t claim_next_ready() {
+    while (true) {
+      size_t tenant = next_ready(cursor_.load(std::memory_order::relaxed));
+      if (tenant == kNone) {
+        return kNone;
+      }
+      uint64_t bit = uint64_t{1} << (tenant % 64);
+      if (!(claimed_[tenant / 64].fetch_or(bit, std::memory_order::acquire)
+            & bit)) {
+        return tenant;
+      }
+    }
+  }
+
+  void release(size_t tenant) {
+    claimed_[tenant / 64].fetch_and(~(uint64_t{1} << (tenant % 64)),
+                                    std::memory_order::release);
+  }
+
+  void advance(size_t tenant) {
+    cursor_.store(tenant + 1 == queues_.size() ? 0 : tenant + 1,
+                  std::memory_order::relaxed);
+  }
+
+  bool any_ready() const {
+    for (size_t w = 0; w < num_words(); w++) {
+      if (ready_[w].load(std::memory_order::seq_cst) != 0) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  // Tenants that are marked and not claimed.
+  uint64_t available(size_t w) const {
+    return ready_[w].load(std::memory_order::acquire)
+         & ~claimed_[w].load(std::memory_order::relaxed);
+  }
+
+  // The first available tenant at or after from, wrapping around.
+  size_t next_ready(size_t from) const {
+    const size_t words = num_words();
+    size_t w = from / 64;
+    uint64_t bits = available(w) & (~uint64_t{0} << (from % 64));
+    for (size_t i = 0; i <= words; i++) {
+      if (bits) {
+        return w * 64 + std::countr_zero(bits);
+      }
+      w = w + 1 == words ? 0 : w + 1;
+      bits = available(w);
+    }
+    return kNone;
+  }
+};
+
+}  // namespace theta
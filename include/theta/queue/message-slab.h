@@ -0,0 +1,211 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <optional>
+#include <thread>
+#include <utility>
+
+#include "theta/queue/defs.h"
+#include "theta/queue/mpmc-queue.h"
+
+namespace theta {
+
+// A fixed pool of message slots addressed by 32-bit handles. Slots are
+// allocated up front, each on its own cache line, and recycled through a
+// lock-free free list, so sending a message never calls malloc and a handle is
+// half the size of a pointer.
+template <typename Msg>
+class MessageSlab {
+  static constexpr uint32_t kNil = UINT32_MAX;
+
+  struct alignas(alignof(Msg) > hardware_constructive_interference_size
+                     ? alignof(Msg)
+                     : hardware_constructive_interference_size) Slot {
+    std::byte storage[sizeof(Msg)];
+  };
+
+ public:
+  using Handle = uint32_t;
+
+  explicit MessageSlab(uint32_t capacity)
+      : capacity_(capacity)
+      , slots_(new Slot[capacity])
+      , next_(new std::atomic<uint32_t>[capacity]) {
+    assert(capacity < kNil);
+    for (uint32_t i = 0; i < capacity; i++) {
+      next_[i].store(i + 1 < capacity ? i + 1 : kNil,
+                     std::memory_order::relaxed);
+    }
+    free_.store(pack(/*tag=*/0, /*index=*/capacity ? 0 : kNil),
+                std::memory_order::release);
+  }
+
+  MessageSlab(const MessageSlab&) = delete;
+  MessageSlab& operator=(const MessageSlab&) = delete;
+
+  // Every allocated handle must have been released.
+  ~MessageSlab() = default;
+
+  // Constructs a message in a free slot. Returns nothing if every slot is in
+  // use.
+  template <typename... Args>
+  std::optional<Handle> try_emplace(Args&&... args) {
+    uint64_t head = free_.load(std::memory_order::acquire);
+    while (true) {
+      uint32_t index = index_of(head);
+      if (index == kNil) {
+        return {};
+      }
+      // next_[index] may be stale if another thread took and returned this
+      // slot in the meantime; the tag makes the CAS fail in that case.
+      uint32_t next = next_[index].load(std::memory_order::relaxed);
+      if (free_.compare_exchange_weak(head,
+                                      pack(tag_of(head) + 1, next),
+                                      std::memory_order::acquire,
+                                      std::memory_order::acquire)) {
+        new (slots_[index].storage) Msg(std::forward<Args>(args)...);
+        return index;
+      }
+    }
+  }
+
+  // Destroys the message and returns its slot to the free list.
+  void release(Handle h) {
+    (*this)[h].~Msg();
+    uint64_t head = free_.load(std::memory_order::relaxed);
+    do {
+      next_[h].store(index_of(head), std::memory_order::relaxed);
+    } while (!free_.compare_exchange_weak(head,
+                                          pack(tag_of(head) + 1, h),
+                                          std::memory_order::release,
+                                          std::memory_order::relaxed));
+  }
+
+  Msg& operator[](Handle h) {
+    assert(h < capacity_);
+    return *std::launder(reinterpret_cast<Msg*>(slots_[h].storage));
+  }
+
+  const Msg& operator[](Handle h) const {
+    assert(h < capacity_);
+    return *std::launder(reinterpret_cast<const Msg*>(slots_[h].storage));
+  }
+
+  void prefetch(Handle h) const { __builtin_prefetch(slots_[h].storage); }
+
+  uint32_t capacity() const { return capacity_; }
+
+ private:
+  const uint32_t capacity_;
+  std::unique_ptr<Slot[]> slots_;
+  std::unique_ptr<std::atomic<uint32_t>[]> next_;
+  // The top of the free list in the low half and an ABA tag in the high half.
+  alignas(hardware_destructive_interference_size) std::atomic<uint64_t> free_;
+
+  static uint64_t pack(uint32_t tag, uint32_t index) {
+    return (static_cast<uint64_t>(tag) << 32) | index;
+  }
+  static uint32_t tag_of(uint64_t v) { return v >> 32; }
+  static uint32_t index_of(uint64_t v) { return static_cast<uint32_t>(v); }
+};
+
+// An MPMCQueue of MessageSlab handles. Producers construct messages in place
+// in the slab and push a 32-bit handle; consumers read the message from the
+// slab and recycle its slot. The slab holds one message fewer than the queue,
+// so a producer that got a slot never waits for room in the queue.
+//
+// try_consume_n() pops a batch of handles and prefetches every payload before
+// handing the first one to the consumer, so that the later ones are likely to
+// be in cache by the time they are read.
+template <typename Msg, size_t kBufferSize = 128>
+class SlabQueue {
+ public:
+  using Handle = typename MessageSlab<Msg>::Handle;
+
+  // The most messages try_consume_n() pops at once.
+  static constexpr size_t kMaxBatch = 16;
+
+  SlabQueue() : slab_(kBufferSize - 1) {}
+
+  ~SlabQueue() {
+    while (try_consume([](Msg&) {})) {
+    }
+  }
+
+  // Returns false if every slot is in use.
+  template <typename... Args>
+  bool try_emplace(Args&&... args) {
+    auto h = slab_.try_emplace(std::forward<Args>(args)...);
+    if (!h) {
+      return false;
+    }
+    queue_.push(*h);
+    return true;
+  }
+
+  template <typename... Args>
+  void emplace(Args&&... args) {
+    while (!try_emplace(args...)) {
+      std::this_thread::yield();
+    }
+  }
+
+  // Pops a message, passes it to fn, and recycles its slot. Returns false if
+  // the queue is empty.
+  template <typename Fn>
+  bool try_consume(Fn&& fn) {
+    auto h = queue_.try_pop();
+    if (!h) {
+      return false;
+    }
+    finish(*h, std::forward<Fn>(fn));
+    return true;
+  }
+
+  // Blocks until a message is available.
+  template <typename Fn>
+  void consume(Fn&& fn) {
+    finish(queue_.pop(), std::forward<Fn>(fn));
+  }
+
+  // Pops up to max_items messages and passes each to fn. Returns the number
+  // consumed.
+  template <typename Fn>
+  size_t try_consume_n(Fn&& fn, size_t max_items = kMaxBatch) {
+    Handle handles[kMaxBatch];
+    size_t n = 0;
+    while (n < std::min(max_items, kMaxBatch)) {
+      auto h = queue_.try_pop();
+      if (!h) {
+        break;
+      }
+      slab_.prefetch(*h);
+      handles[n++] = *h;
+    }
+    for (size_t i = 0; i < n; i++) {
+      finish(handles[i], fn);
+    }
+    return n;
+  }
+
+  size_t size() const { return queue_.size(); }
+
+  uint32_t capacity() const { return slab_.capacity(); }
+
+ private:
+  MessageSlab<Msg> slab_;
+  MPMCQueue<Handle, kBufferSize> queue_;
+
+  template <typename Fn>
+  void finish(Handle h, Fn&& fn) {
+    fn(slab_[h]);
+    slab_.release(h);
+  }
+};
+
+}  // namespace theta
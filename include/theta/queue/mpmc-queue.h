@@ -1,15 +1,26 @@
 #pragma once
 
+#include <algorithm>
 #include <atomic>
+#include <bit>
+#include <chrono>
 #include <cmath>
+#include <coroutine>
 #include <cstdint>
+#include <cstring>
 #include <memory>
 #include <optional>
+#include <thread>
 #include <type_traits>
 #include <vector>
 
+#include "theta/queue/async-waiters.h"
 #include "theta/queue/defs.h"
+#include "theta/queue/page-buffer.h"
+#include "theta/queue/queue-event.h"
 #include "theta/queue/queue-opts.h"
+#include "theta/queue/readiness-notifier.h"
+#include "theta/queue/slot-scan.h"
 
 namespace theta {
 
@@ -146,34 +157,277 @@ class MPMCQueue {
   static_assert(sizeof(Data) == sizeof(Data::line), "");
   static_assert(sizeof(Data) == 16, "");
 
+  // A slot holds an item together with the tag of the ticket that last wrote
+  // it. The queue reads and writes slots as whole words through one of the
+  // two layouts below.
+  //
+  // The slot index is implied by the slot's position, so a slot's tag keeps
+  // only the ticket's lap (ticket / kBufferSize) and its flags. The role flag
+  // is inverted relative to Tag, set for producers, so that the consumer of
+  // lap 0 encodes as zero. Tickets start at lap 1, whose producers wait for
+  // exactly that consumer, so a zero-filled buffer is ready to use without
+  // initialization, and pages of it that are never reached are never touched.
+  static constexpr int kIndexBits = std::countr_zero(kBufferSize);
+
+  // A 16-byte Data line, for items of up to 8 bytes. The tag half holds a
+  // 62-bit lap with the producer flag in Tag's consumer bit.
+  struct WideSlot {
+    using Word = __int128;
+
+    Data data;
+
+    static Tag encode(Tag tag) {
+      return Tag{(tag.value() >> kIndexBits)
+                 | (tag.is_producer() ? Tag::kConsumerFlag : 0)
+                 | (tag.is_waiting() ? Tag::kWaitingFlag : 0)};
+    }
+
+    static Word make(T value, Tag tag) {
+      return Data{value, encode(tag)}.line.load(std::memory_order::relaxed);
+    }
+    static T value_of(Word w) { return Data{w}.value; }
+    static bool has_tag(Word w, Tag tag) {
+      return (Data{w}.tag.raw & ~Tag::kWaitingFlag) == encode(tag).raw;
+    }
+    static bool is_waiting(Word w) { return Data{w}.tag.is_waiting(); }
+
+    Word load(std::memory_order order) const { return data.line.load(order); }
+    void store(Word w, std::memory_order order) { data.line.store(w, order); }
+    Word exchange(Word w, std::memory_order order) {
+      return data.line.exchange(w, order);
+    }
+
+    // Sets the waiting flag if the slot's tag still matches w. Only the tag
+    // half is written. On failure, the tag in w is refreshed.
+    bool mark_waiting(Word& w) {
+      Tag observed = Data{w}.tag;
+      Tag want = observed;
+      want.mark_as_waiting();
+      bool marked = data.tag_atomic.compare_exchange_weak(
+          observed,
+          want,
+          std::memory_order::release,
+          std::memory_order::relaxed);
+      w = Data{value_of(w), marked ? want : observed}.line.load(
+          std::memory_order::relaxed);
+      return marked;
+    }
+    void wait(Word w) const {
+      data.tag_atomic.wait(Data{w}.tag, std::memory_order::acquire);
+    }
+    void notify_all() { data.tag_atomic.notify_all(); }
+
+    // The upper half of the tag, which holds the flags and so changes on
+    // every write. Used as a futex word when wakeups are batched.
+    const void* futex_word() const {
+      return reinterpret_cast<const uint32_t*>(&data.tag_atomic) + 1;
+    }
+    static uint32_t futex_value(Word w) { return Data{w}.tag.raw >> 32; }
+
+    // The number of leading slots that hold the items of consecutive tickets
+    // starting at first, none of which may cross the end of the buffer. Tags
+    // are the second word of each slot, and slots in one pass over the buffer
+    // share a lap, so every tag in the run is the same.
+    static size_t ready_run(const WideSlot* slots, size_t n, Tag first) {
+      return internal::scan_tags</*kStride=*/2>(
+          reinterpret_cast<const uint64_t*>(slots),
+          n,
+          /*mask=*/~Tag::kWaitingFlag,
+          /*expected=*/encode(first).raw,
+          /*step=*/0);
+    }
+  };
+
+  // One 64-bit word for items of up to 4 bytes: the item in the low half and
+  // a 32-bit tag in the high half, with a 30-bit lap counter and the two
+  // flags. Laps are compared modulo 2^30, which only matters for a thread that
+  // falls 2^30 laps behind.
+  struct CompactSlot {
+    using Word = uint64_t;
+
+    static constexpr uint32_t kProducerBit = 1U << 31;
+    static constexpr uint32_t kWaitingBit = 1U << 30;
+    static constexpr uint32_t kLapMask = kWaitingBit - 1;
+
+    std::atomic<Word> word{0};
+
+    static uint32_t encode(Tag tag) {
+      return ((tag.value() >> kIndexBits) & kLapMask)
+           | (tag.is_producer() ? kProducerBit : 0)
+           | (tag.is_waiting() ? kWaitingBit : 0);
+    }
+
+    static Word make(T value, Tag tag) {
+      uint32_t bits = 0;
+      memcpy(&bits, &value, sizeof(T));
+      return (static_cast<Word>(encode(tag)) << 32) | bits;
+    }
+    static T value_of(Word w) {
+      uint32_t bits = static_cast<uint32_t>(w);
+      T value;
+      memcpy(&value, &bits, sizeof(T));
+      return value;
+    }
+    static bool has_tag(Word w, Tag tag) {
+      return ((w >> 32) & ~kWaitingBit) == encode(tag);
+    }
+    static bool is_waiting(Word w) { return (w >> 32) & kWaitingBit; }
+
+    Word load(std::memory_order order) const { return word.load(order); }
+    void store(Word w, std::memory_order order) { word.store(w, order); }
+    Word exchange(Word w, std::memory_order order) {
+      return word.exchange(w, order);
+    }
+
+    bool mark_waiting(Word& w) {
+      Word want = w | (static_cast<Word>(kWaitingBit) << 32);
+      if (word.compare_exchange_weak(w,
+                                     want,
+                                     std::memory_order::release,
+                                     std::memory_order::relaxed)) {
+        w = want;
+        return true;
+      }
+      return false;
+    }
+    void wait(Word w) const { word.wait(w, std::memory_order::acquire); }
+    void notify_all() { word.notify_all(); }
+
+    const void* futex_word() const {
+      return reinterpret_cast<const uint32_t*>(&word) + 1;
+    }
+    static uint32_t futex_value(Word w) { return w >> 32; }
+
+    static size_t ready_run(const CompactSlot* slots, size_t n, Tag first) {
+      return internal::scan_tags</*kStride=*/1>(
+          reinterpret_cast<const uint64_t*>(slots),
+          n,
+          /*mask=*/static_cast<Word>(~kWaitingBit) << 32,
+          /*expected=*/static_cast<Word>(encode(first)) << 32,
+          /*step=*/0);
+    }
+  };
+  static_assert(sizeof(CompactSlot) == 8, "");
+
+  static_assert(std::endian::native == std::endian::little,
+                "futex_word() assumes the flags are in the upper half");
+
+  using Slot = std::conditional_t<sizeof(T) <= 4, CompactSlot, WideSlot>;
+  using Word = typename Slot::Word;
+
  public:
-  MPMCQueue()
+  // The most items drain_to() pops with one update of head.
+  static constexpr size_t kDrainChunk = 64;
+
+  // Awaitable returned by async_pop(). The awaiter itself is the node that is
+  // parked in the queue's waiter list, so suspending never allocates.
+  template <CoroutineExecutor Executor>
+  class PopAwaiter : public AsyncWaiter {
+   public:
+    PopAwaiter(MPMCQueue* queue, Executor* executor)
+        : queue_(queue), executor_(executor) {}
+
+    bool await_ready() {
+      value_ = queue_->try_pop();
+      return value_.has_value();
+    }
+
+    void await_suspend(std::coroutine_handle<> handle) {
+      handle_ = handle;
+      queue_->pop_waiters_.park(this, [q = queue_]() { return q->has_data(); });
+    }
+
+    T await_resume() { return *value_; }
+
+    bool try_complete() override {
+      value_ = queue_->try_pop();
+      if (!value_.has_value()) {
+        return false;
+      }
+      executor_->schedule(handle_);
+      return true;
+    }
+
+   private:
+    MPMCQueue* queue_;
+    Executor* executor_;
+    std::coroutine_handle<> handle_;
+    std::optional<T> value_;
+  };
+
+  // Awaitable returned by async_push().
+  template <CoroutineExecutor Executor>
+  class PushAwaiter : public AsyncWaiter {
+   public:
+    PushAwaiter(MPMCQueue* queue, Executor* executor, T val)
+        : queue_(queue), executor_(executor), val_(val) {}
+
+    bool await_ready() { return queue_->try_push(val_); }
+
+    void await_suspend(std::coroutine_handle<> handle) {
+      handle_ = handle;
+      queue_->push_waiters_.park(this,
+                                 [q = queue_]() { return q->has_space(); });
+    }
+
+    void await_resume() {}
+
+    bool try_complete() override {
+      if (!queue_->try_push(val_)) {
+        return false;
+      }
+      executor_->schedule(handle_);
+      return true;
+    }
+
+   private:
+    MPMCQueue* queue_;
+    Executor* executor_;
+    std::coroutine_handle<> handle_;
+    T val_;
+  };
+
+  MPMCQueue() : MPMCQueue(QueueOpts{}) {}
+  // The slot array starts out zeroed, which needs no further initialization.
+  // Prefaulting and locking need the array in its own mapping, however small.
+  MPMCQueue(const QueueOpts& opts)
       : head_(Tag::kBufferWrapDelta)
       , tail_(Tag::kBufferWrapDelta)
-      , buffer_(kBufferSize) {
-    Tag tag;
-    tag.mark_as_consumer();
-    for (size_t i = 0; i < buffer_.size(); i++) {
-      buffer_[tag.to_index()].tag = tag;
-      ++tag;
+      , buffer_(kBufferSize,
+                /*map_pages=*/opts.prefault_threads() > 0 ||
+                    opts.lock_memory()) {
+    if (opts.prefault_threads() > 0) {
+      buffer_.prefault(opts.prefault_threads());
+    }
+    if (opts.lock_memory()) {
+      buffer_.lock();
+    }
+
+    notifier_ = opts.readiness_notifier();
+    if (opts.wakeup_batch_size() > 1) {
+      wake_batch_size_ = opts.wakeup_batch_size();
+      wake_batch_delay_ = opts.wakeup_batch_delay();
+      pending_wakes_ = std::make_unique<std::atomic<uint64_t>[]>(
+          kPendingWakeWords);
+      wake_flusher_ = std::thread{[this]() { run_wake_flusher(); }};
     }
-    std::atomic_thread_fence(std::memory_order::release);
   }
-  MPMCQueue(const QueueOpts&) : MPMCQueue() {}
 
+  // Items are trivially destructible, so any left in the queue are discarded
+  // along with the slot array.
   ~MPMCQueue() {
-    while (true) {
-      auto v = try_pop();
-      if (!v) {
-        break;
-      }
+    if (wake_flusher_.joinable()) {
+      stop_flusher_.store(true, std::memory_order::seq_cst);
+      flusher_event_.notify_all();
+      wake_flusher_.join();
     }
   }
 
   void push(T val) {
     Tag tail{tail_.tag_raw_atomic.fetch_add(Tag::kIncrement,
-                                            std::memory_order::acq_rel)};
+                                            std::memory_order::seq_cst)};
     do_push(std::move(val), tail);
+    notify_consumers();
   }
 
   bool try_push(T val) {
@@ -186,7 +440,7 @@ class MPMCQueue {
     while (
         !tail_.tag_atomic.compare_exchange_weak(expected_tail,
                                                 desired_tail,
-                                                std::memory_order::release,
+                                                std::memory_order::seq_cst,
                                                 std::memory_order::relaxed)) {
       desired_tail = expected_tail;
       desired_tail++;
@@ -196,17 +450,32 @@ class MPMCQueue {
     }
 
     do_push(std::move(val), expected_tail);
+    notify_consumers();
     return true;
   }
 
-  T pop() {
+  T pop() { return pop(nullptr); }
+
+  // As pop(), and stores the item's sequence number in *seq: its position in
+  // push order, counting from zero. Items popped by several workers can be
+  // put back in order with a ReorderBuffer. reset() leaves a gap in the
+  // sequence where the discarded items were.
+  T pop(uint64_t* seq) {
     Tag tag{/*raw=*/head_.tag_raw_atomic.fetch_add(Tag::kIncrement,
-                                                   std::memory_order::acq_rel)};
+                                                   std::memory_order::seq_cst)};
+    if (seq) {
+      *seq = sequence_of(tag);
+    }
     tag.mark_as_consumer();
-    return do_pop(tag);
+    T val = do_pop(tag);
+    push_waiters_.wake([this]() { return has_space(); });
+    return val;
   }
 
-  std::optional<T> try_pop() {
+  std::optional<T> try_pop() { return try_pop(nullptr); }
+
+  // As try_pop(), and stores the item's sequence number as pop(seq) does.
+  std::optional<T> try_pop(uint64_t* seq) {
     const Tag tail{tail_.tag_atomic.load(std::memory_order::acquire)};
 
     Tag desired_head{tail.raw};
@@ -215,7 +484,7 @@ class MPMCQueue {
     while (
         !head_.tag_atomic.compare_exchange_weak(expected_head,
                                                 desired_head,
-                                                std::memory_order::release,
+                                                std::memory_order::seq_cst,
                                                 std::memory_order::relaxed)) {
       desired_head = expected_head;
       desired_head++;
@@ -224,10 +493,139 @@ class MPMCQueue {
       }
     }
 
+    if (seq) {
+      *seq = sequence_of(expected_head);
+    }
     expected_head.mark_as_consumer();
-    return do_pop(expected_head);
+    T val = do_pop(expected_head);
+    push_waiters_.wake([this]() { return has_space(); });
+    return val;
+  }
+
+  // Pops up to max_items items into out, taking only the run at the front of
+  // the queue whose producers have finished writing, so it never waits.
+  // Readiness is checked for several slots at a time with SIMD loads, and the
+  // whole run is claimed with a single update of head. Returns the number of
+  // items popped.
+  size_t try_pop_n(T* out, size_t max_items) {
+    Tag head{head_.tag_atomic.load(std::memory_order::acquire)};
+    size_t n;
+    while (true) {
+      const Tag tail{tail_.tag_atomic.load(std::memory_order::acquire)};
+      if (tail <= head) {
+        return 0;
+      }
+      n = ready_run(head,
+                    std::min<size_t>(max_items,
+                                     (tail.raw - head.raw) / Tag::kIncrement));
+      if (n == 0) {
+        return 0;
+      }
+      if (head_.tag_atomic.compare_exchange_weak(
+              head,
+              Tag{head.raw + n * Tag::kIncrement},
+              std::memory_order::seq_cst,
+              std::memory_order::acquire)) {
+        break;
+      }
+    }
+
+    for (size_t i = 0; i < n; i++) {
+      Tag tag{head.raw + i * Tag::kIncrement};
+      tag.mark_as_consumer();
+      out[i] = do_pop(tag);
+    }
+    push_waiters_.wake([this]() { return has_space(); });
+    return n;
+  }
+
+  // Pops every item whose producer has finished writing and passes it to fn,
+  // in batches of up to kDrainChunk. Returns the number of items drained.
+  template <typename Fn>
+  size_t drain_to(Fn&& fn) {
+    size_t total = 0;
+    T chunk[kDrainChunk];
+    while (size_t n = try_pop_n(chunk, kDrainChunk)) {
+      for (size_t i = 0; i < n; i++) {
+        fn(chunk[i]);
+      }
+      total += n;
+    }
+    return total;
+  }
+
+  // Discards every item in O(1) by moving head to tail. The queue must be
+  // quiescent: no other thread may be inside any member function, including
+  // blocked in push() or pop(), and every push must have completed.
+  //
+  // The discarded tickets' slots are left as they are. The producers of the
+  // next lap would wait for those tickets' consumers, so reset() records
+  // tail as a floor, and a producer whose paired ticket is below the floor
+  // takes its slot without checking the tag.
+  void reset() {
+    const Tag tail{tail_.tag_atomic.load(std::memory_order::relaxed)};
+    head_.tag_atomic.store(tail, std::memory_order::relaxed);
+    reset_floor_.store(tail.raw, std::memory_order::relaxed);
+    if (pending_wakes_) {
+      wake_deadline_ns_.store(0, std::memory_order::relaxed);
+      num_pending_wakes_.store(0, std::memory_order::relaxed);
+      for (size_t w = 0; w < kPendingWakeWords; w++) {
+        pending_wakes_[w].store(0, std::memory_order::relaxed);
+      }
+    }
+    std::atomic_thread_fence(std::memory_order::seq_cst);
+  }
+
+  // Pops an item from a coroutine. If the queue is empty, the coroutine is
+  // suspended and later resumed through executor by the thread whose push
+  // made an item available; no thread parks on the queue. A push that races
+  // with the suspension may still briefly wait on an in-flight producer.
+  template <CoroutineExecutor Executor>
+  PopAwaiter<Executor> async_pop(Executor& executor) {
+    return {this, &executor};
+  }
+
+  PopAwaiter<InlineExecutor> async_pop() {
+    static InlineExecutor executor;
+    return async_pop(executor);
   }
 
+  // Pushes an item from a coroutine, suspending it while the queue is full.
+  template <CoroutineExecutor Executor>
+  PushAwaiter<Executor> async_push(T val, Executor& executor) {
+    return {this, &executor, val};
+  }
+
+  PushAwaiter<InlineExecutor> async_push(T val) {
+    static InlineExecutor executor;
+    return async_push(val, executor);
+  }
+
+  // Returns the item at the front of the queue without removing it, or
+  // nothing if the queue is empty or the front item is still being written.
+  // The item may be popped as soon as this returns. For pointer payloads, hold
+  // an EpochDomain::Guard across the call and the use of the result, and have
+  // consumers retire() what they pop, so that the pointee stays valid.
+  std::optional<T> peek() const {
+    const Tag head{head_.tag_atomic.load(std::memory_order::acquire)};
+    const Tag tail{tail_.tag_atomic.load(std::memory_order::acquire)};
+    if (tail <= head) {
+      return {};
+    }
+
+    Word observed
+        = buffer_[head.to_index()].load(std::memory_order::acquire);
+    // The slot holds head's item once its producer has tagged it with the
+    // same ticket.
+    if (!Slot::has_tag(observed, head)) {
+      return {};
+    }
+    return Slot::value_of(observed);
+  }
+
+  // True if QueueOpts::set_lock_memory() was requested and mlock() succeeded.
+  bool memory_locked() const { return buffer_.locked(); }
+
   size_t size() const {
     // Reading head before tail will make it possible to "see" more elements in
     // the queue than it can hold, but this makes it so that the size will
@@ -240,39 +638,136 @@ class MPMCQueue {
 
   static constexpr size_t capacity() { return kBufferSize; }
 
+  // Re-arms the readiness notifier once the consumer has drained the queue.
+  // Returns false if items arrived in the meantime, in which case the consumer
+  // should keep draining rather than wait on the notifier's fd.
+  bool arm_notifier() {
+    assert(notifier_);
+    notifier_->arm();
+    return !poll_ready();
+  }
+
+  // Signaled after pushes while a consumer waits for the queue to become
+  // non-empty. See wait_any().
+  QueueEvent& ready_event() { return ready_event_; }
+
+  // Returns true if the queue holds items, ordered after any preceding
+  // QueueEvent::prepare_wait() or ReadinessNotifier::arm().
+  bool poll_ready() {
+    std::atomic_thread_fence(std::memory_order::seq_cst);
+    return has_data();
+  }
+
  private:
   alignas(hardware_destructive_interference_size) Index head_;
   alignas(hardware_destructive_interference_size) Index tail_;
-  alignas(hardware_destructive_interference_size) std::vector<Data> buffer_;
+  alignas(hardware_destructive_interference_size)
+      internal::PageBuffer<Slot> buffer_;
+  AsyncWaiterList pop_waiters_;
+  AsyncWaiterList push_waiters_;
+  ReadinessNotifier* notifier_{nullptr};
+  QueueEvent ready_event_;
+  // The tail at the last reset(). Only read by producers that find a slot
+  // with an unexpected tag.
+  std::atomic<uint64_t> reset_floor_{0};
+
+  // Batched wakeups. While enabled, slot waits and wakes use a futex on the
+  // upper half of the slot's tag, and a producer that finds a consumer
+  // waiting on its slot sets the slot's bit in pending_wakes_ instead of
+  // waking it. The first deferred wakeup of a batch sets wake_deadline_ns_,
+  // and whichever comes first of a later push and wake_flusher_ flushes the
+  // batch once the deadline has passed. 0 means no deadline is set.
+  static constexpr size_t kPendingWakeWords = (kBufferSize + 63) / 64;
+  size_t wake_batch_size_{1};
+  std::chrono::nanoseconds wake_batch_delay_{0};
+  std::unique_ptr<std::atomic<uint64_t>[]> pending_wakes_;
+  alignas(hardware_destructive_interference_size)
+      std::atomic<size_t> num_pending_wakes_{0};
+  std::atomic<int64_t> wake_deadline_ns_{0};
+  QueueEvent flusher_event_;
+  std::atomic<bool> stop_flusher_{false};
+  std::thread wake_flusher_;
+
+  void notify_consumers() {
+    pop_waiters_.wake([this]() { return has_data(); });
+    ready_event_.notify();
+    if (notifier_) {
+      notifier_->notify();
+    }
+  }
+
+  // The readiness checks for parked coroutines. These pair with the seq_cst
+  // updates of head_ and tail_ so that a waiter is either seen by the waking
+  // thread or sees the state change itself.
+  bool has_data() const {
+    auto head = head_.tag_atomic.load(std::memory_order::seq_cst);
+    auto tail = tail_.tag_atomic.load(std::memory_order::seq_cst);
+    return tail.raw > head.raw;
+  }
+
+  // try_push() leaves one slot free, so this matches what it will accept.
+  bool has_space() const {
+    auto tail = tail_.tag_atomic.load(std::memory_order::seq_cst);
+    auto head = head_.tag_atomic.load(std::memory_order::seq_cst);
+    return tail.raw + Tag::kIncrement < head.raw + Tag::kBufferWrapDelta;
+  }
+
+  // Tickets start at the second lap.
+  static uint64_t sequence_of(Tag ticket) {
+    return (ticket.value() - Tag::kBufferWrapDelta) / Tag::kIncrement;
+  }
+
+  // The number of slots, starting at ticket first, that hold the items of
+  // consecutive tickets, up to n.
+  size_t ready_run(Tag first, size_t n) const {
+    size_t ready = 0;
+    while (ready < n) {
+      Tag tag{first.raw + ready * Tag::kIncrement};
+      size_t index = tag.to_index();
+      size_t len = std::min<size_t>(n - ready, kBufferSize - index);
+      size_t run = Slot::ready_run(&buffer_[index], len, tag);
+      ready += run;
+      if (run < len) {
+        break;
+      }
+    }
+    return ready;
+  }
 
   void do_push(T val, const Tag& tag) {
     assert(tag.is_producer());
     assert(!tag.is_waiting());
 
-    int idx = tag.to_index();
+    Slot& slot = buffer_[tag.to_index()];
 
     // This is the strangest issue -- with Ubuntu clang version 15.0.7,
     // when observed_data is defined inside of the loop scope, benchmarks will
     // slow down by over 5x.
-    Data observed_data;
+    Word observed_data;
     while (true) {
-      __int128 observed_data_line
-          = buffer_[idx].line.load(std::memory_order::acquire);
-      observed_data = Data{/*line=*/observed_data_line};
+      observed_data = slot.load(std::memory_order::acquire);
 
-      if (tag.is_paired(observed_data.tag)) {
+      if (Slot::has_tag(observed_data, tag.prev_paired_tag())) {
+        break;
+      }
+      // The slot has not been reused since reset() discarded its ticket.
+      if (tag.raw < reset_floor_.load(std::memory_order::relaxed)
+                        + Tag::kBufferWrapDelta) {
         break;
       }
 
-      wait_for_data(tag, observed_data.tag);
+      wait_for_data(slot, tag, observed_data);
     }
 
-    Data new_data{/*value_=*/val, /*tag_=*/tag};
-    Data old_data{buffer_[idx].line.exchange(
-        new_data.line.load(std::memory_order::relaxed),
-        std::memory_order::acq_rel)};
-    if (old_data.tag.is_waiting()) {
-      buffer_[idx].tag_atomic.notify_all();
+    Word old_data
+        = slot.exchange(Slot::make(val, tag), std::memory_order::acq_rel);
+    if (pending_wakes_) {
+      if (Slot::is_waiting(old_data)) {
+        defer_wake(tag.to_index());
+      }
+      flush_overdue_wakes();
+    } else if (Slot::is_waiting(old_data)) {
+      slot.notify_all();
     }
   }
 
@@ -280,53 +775,123 @@ class MPMCQueue {
     assert(tag.is_consumer());
     assert(!tag.is_waiting());
 
-    int idx = tag.to_index();
+    Slot& slot = buffer_[tag.to_index()];
 
-    Data observed_data;
+    Word observed_data;
     while (true) {
-      observed_data
-          = Data{/*line=*/buffer_[idx].line.load(std::memory_order::acquire)};
+      observed_data = slot.load(std::memory_order::acquire);
 
-      if (tag.is_paired(observed_data.tag)) {
+      if (Slot::has_tag(observed_data, tag.prev_paired_tag())) {
         break;
       }
 
-      wait_for_data(tag, observed_data.tag);
+      wait_for_data(slot, tag, observed_data);
     }
 
     // This is another strange issue -- it is faster to exchange the __int128
     // value backing the Data object instead of just exchanging the 8 byte tag
     // value inside of that Data object.
-    Data old_data{buffer_[idx].line.exchange(
-        Data{/*value=*/T{}, /*tag=*/tag}.line.load(std::memory_order::relaxed),
-        std::memory_order::acq_rel)};
+    Word old_data
+        = slot.exchange(Slot::make(T{}, tag), std::memory_order::acq_rel);
+
+    // Producers waiting for space are woken right away, even when consumer
+    // wakeups are batched.
+    if (Slot::is_waiting(old_data)) {
+      if (pending_wakes_) {
+        internal::futex_wake_all(slot.futex_word());
+      } else {
+        slot.notify_all();
+      }
+    }
 
-    if (old_data.tag.is_waiting()) {
-      buffer_[idx].tag_atomic.notify_all();
+    return Slot::value_of(observed_data);
+  }
+
+  static int64_t now_ns() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+  }
+
+  void defer_wake(size_t index) {
+    pending_wakes_[index / 64].fetch_or(1ULL << (index % 64),
+                                        std::memory_order::relaxed);
+    size_t pending
+        = num_pending_wakes_.fetch_add(1, std::memory_order::acq_rel);
+    if (pending + 1 >= wake_batch_size_) {
+      flush_wakes();
+    } else if (pending == 0) {
+      wake_deadline_ns_.store(now_ns() + wake_batch_delay_.count(),
+                              std::memory_order::seq_cst);
+      flusher_event_.notify();
     }
+  }
 
-    return observed_data.value;
+  void flush_overdue_wakes() {
+    int64_t deadline = wake_deadline_ns_.load(std::memory_order::relaxed);
+    if (deadline != 0 && now_ns() >= deadline) {
+      flush_wakes();
+    }
+  }
+
+  void flush_wakes() {
+    // The deadline is cleared first, so a wakeup deferred after the exchange
+    // below starts a new batch with its own deadline, and one deferred before
+    // it has its bit seen by the scan.
+    wake_deadline_ns_.store(0, std::memory_order::relaxed);
+    if (num_pending_wakes_.exchange(0, std::memory_order::acq_rel) == 0) {
+      return;
+    }
+    for (size_t w = 0; w < kPendingWakeWords; w++) {
+      uint64_t bits = pending_wakes_[w].exchange(0, std::memory_order::acq_rel);
+      while (bits) {
+        size_t index = w * 64 + std::countr_zero(bits);
+        internal::futex_wake_all(buffer_[index].futex_word());
+        bits &= bits - 1;
+      }
+    }
   }
 
-  void wait_for_data(const Tag& claimed_tag, Tag observed_tag) {
-    int idx = claimed_tag.to_index();
+  void wait_for_data(Slot& slot, const Tag& claimed_tag, Word observed) {
+    const Tag paired_tag = claimed_tag.prev_paired_tag();
     while (true) {
-      Tag want_tag{observed_tag};
-      want_tag.mark_as_waiting();
-      if ((observed_tag == want_tag)
-          || buffer_[idx].tag_atomic.compare_exchange_weak(
-              observed_tag,
-              want_tag,
-              std::memory_order::release,
-              std::memory_order::relaxed)) {
-        buffer_[idx].tag_atomic.wait(want_tag, std::memory_order::acquire);
+      if (Slot::is_waiting(observed) || slot.mark_waiting(observed)) {
+        if (pending_wakes_) {
+          internal::futex_wait(slot.futex_word(), Slot::futex_value(observed));
+        } else {
+          slot.wait(observed);
+        }
         break;
       }
 
-      if (claimed_tag.is_paired(observed_tag)) {
+      if (Slot::has_tag(observed, paired_tag)) {
         break;
       }
     }
   }
+
+  // Flushes a batch whose deadline passes with no push to flush it. Sleeps
+  // without a timeout while no wakeup is pending.
+  void run_wake_flusher() {
+    while (true) {
+      uint32_t epoch = flusher_event_.prepare_wait();
+      if (stop_flusher_.load(std::memory_order::seq_cst)) {
+        flusher_event_.cancel_wait();
+        return;
+      }
+      int64_t deadline = wake_deadline_ns_.load(std::memory_order::seq_cst);
+      if (deadline == 0) {
+        flusher_event_.wait(epoch);
+        continue;
+      }
+      int64_t remaining = deadline - now_ns();
+      if (remaining > 0) {
+        flusher_event_.wait_for(epoch, std::chrono::nanoseconds{remaining});
+        continue;
+      }
+      flusher_event_.cancel_wait();
+      flush_overdue_wakes();
+    }
+  }
 };
 }  // namespace theta
@@ -9,8 +9,11 @@
 #include <type_traits>
 #include <vector>
 
+#include "theta/queue/asymmetric-fence.h"
 #include "theta/queue/defs.h"
+#include "theta/queue/queue-event.h"
 #include "theta/queue/queue-opts.h"
+#include "theta/queue/readiness-notifier.h"
 
 namespace theta {
 
@@ -18,8 +21,28 @@ namespace theta {
 // If more than one consumer exists at once, no items will be lost, but it is
 // possible for events to appear out of order. This requires that no producer
 // adds a "zero" item.
-template <ZeroableAtomType T>
+//
+// With kAsymmetricFences, producers publish with relaxed atomics behind a
+// compiler-only barrier and the consumer pays for the ordering with a
+// membarrier(2) call instead. This suits queues with many busy producers and a
+// consumer that runs rarely and drains in bulk via drain_to().
+template <ZeroableAtomType T, bool kAsymmetricFences = false>
 class MPSCQueue {
+  static constexpr std::memory_order kProducerLoad
+      = kAsymmetricFences ? std::memory_order::relaxed
+                          : std::memory_order::acquire;
+  static constexpr std::memory_order kProducerStore
+      = kAsymmetricFences ? std::memory_order::relaxed
+                          : std::memory_order::release;
+  // Claiming a slot is seq_cst so that it orders against the readiness
+  // notifier's flag; on x86 this is the same instruction as release.
+  static constexpr std::memory_order kProducerClaim
+      = kAsymmetricFences ? std::memory_order::relaxed
+                          : std::memory_order::seq_cst;
+
+  // The maximum number of items drain_to() reads between heavy barriers.
+  static constexpr size_t kDrainChunk = 64;
+
  public:
   static constexpr size_t next_pow_2(int v) {
     if ((v & (v - 1)) == 0) {
@@ -30,8 +53,13 @@ class MPSCQueue {
   }
 
   MPSCQueue(QueueOpts opts)
-      : ht_(/*head=*/0, /*tail=*/0), buf_(next_pow_2(opts.max_size())) {
+      : ht_(/*head=*/0, /*tail=*/0)
+      , buf_(next_pow_2(opts.max_size()))
+      , notifier_(opts.readiness_notifier()) {
     CHECK(capacity());
+    if constexpr (kAsymmetricFences) {
+      asymmetric_fences_supported();
+    }
   }
 
   ~MPSCQueue() {
@@ -47,7 +75,10 @@ class MPSCQueue {
 
   bool try_push(T val, size_t* num_items) {
     DCHECK(val);
-    uint64_t expected = ht_.line.load(std::memory_order::acquire);
+    if constexpr (kAsymmetricFences) {
+      asymmetric_light_barrier();
+    }
+    uint64_t expected = ht_.line.load(kProducerLoad);
     uint32_t head, tail;
     do {
       size_t s = size(expected, buf_.size());
@@ -71,7 +102,7 @@ class MPSCQueue {
     } while (!ht_.line.compare_exchange_weak(
         expected,
         HeadTail{head, tail}.line.load(std::memory_order::relaxed),
-        std::memory_order::release,
+        kProducerClaim,
         std::memory_order::relaxed));
 
     uint32_t index = HeadTail{expected}.tail;
@@ -82,12 +113,19 @@ class MPSCQueue {
       T expect_zero{};
       if (buf_[index].compare_exchange_weak(expect_zero,
                                             val,
-                                            std::memory_order::release,
+                                            kProducerStore,
                                             std::memory_order::relaxed)) {
         break;
       }
     }
 
+    if constexpr (kAsymmetricFences) {
+      asymmetric_light_barrier();
+    }
+    ready_event_.notify();
+    if (notifier_) {
+      notifier_->notify();
+    }
     return true;
   }
 
@@ -96,24 +134,89 @@ class MPSCQueue {
     if (!maybe_index.has_value()) {
       return {};
     }
-    auto index = maybe_index.value();
-
-    T t{};
-    // It's possible that a push operation has obtained this index but hasn't
-    // yet written its value which will cause us to spin.
-    do {
-      t = buf_[index].exchange(t, std::memory_order::acq_rel);
-    } while (!t);
 
+    T t = take(maybe_index.value());
+    if constexpr (kAsymmetricFences) {
+      asymmetric_heavy_barrier();
+    }
     return t;
   }
 
+  // Pops every item and passes it to fn. In asymmetric mode, a single heavy
+  // barrier covers each chunk of items instead of one per item.
+  template <typename Fn>
+  size_t drain_to(Fn&& fn) {
+    size_t total = 0;
+    T chunk[kDrainChunk];
+    while (true) {
+      size_t n = 0;
+      while (n < kDrainChunk) {
+        auto maybe_index = reserve_for_pop();
+        if (!maybe_index.has_value()) {
+          break;
+        }
+        chunk[n++] = take(maybe_index.value());
+      }
+      if (n == 0) {
+        return total;
+      }
+
+      if constexpr (kAsymmetricFences) {
+        asymmetric_heavy_barrier();
+      }
+      for (size_t i = 0; i < n; i++) {
+        fn(chunk[i]);
+      }
+      total += n;
+    }
+  }
+
+  // Returns the item at the front of the queue without removing it, or
+  // nothing if the queue is empty or the front item is still being written.
+  // May be called from any thread; see MPMCQueue::peek() for inspecting
+  // pointer payloads safely.
+  std::optional<T> peek() const {
+    uint64_t line = ht_.line.load(std::memory_order::acquire);
+    if (size(line, buf_.size()) == 0) {
+      return {};
+    }
+    T val = buf_[HeadTail{line}.head].load(std::memory_order::acquire);
+    if (!val) {
+      return {};
+    }
+    return val;
+  }
+
   size_t size() const {
     return size(ht_.line.load(std::memory_order::acquire), buf_.size());
   }
 
   size_t capacity() const { return buf_.size() - 1; }
 
+  // Re-arms the readiness notifier once the consumer has drained the queue.
+  // Returns false if items arrived in the meantime, in which case the consumer
+  // should keep draining rather than wait on the notifier's fd.
+  bool arm_notifier() {
+    assert(notifier_);
+    notifier_->arm();
+    return !poll_ready();
+  }
+
+  // Signaled after pushes while a consumer waits for the queue to become
+  // non-empty. See wait_any().
+  QueueEvent& ready_event() { return ready_event_; }
+
+  // Returns true if the queue holds items, ordered after any preceding
+  // QueueEvent::prepare_wait() or ReadinessNotifier::arm().
+  bool poll_ready() {
+    if constexpr (kAsymmetricFences) {
+      asymmetric_heavy_barrier();
+    } else {
+      std::atomic_thread_fence(std::memory_order::seq_cst);
+    }
+    return size(ht_.line.load(std::memory_order::seq_cst), buf_.size()) > 0;
+  }
+
  private:
   // TODO(lpe): It's possible to make this structure naturally fall back to a
   // traditional threadqueue, thereby removing the size limit. This would
@@ -165,6 +268,9 @@ class MPSCQueue {
   alignas(
       hardware_destructive_interference_size) std::vector<std::atomic<T>> buf_;
 
+  ReadinessNotifier* const notifier_;
+  QueueEvent ready_event_;
+
   static inline constexpr size_t size(uint64_t line, size_t buf_size) {
     uint32_t head = HeadTail(line).head;
     uint32_t tail = HeadTail(line).tail;
@@ -174,6 +280,17 @@ class MPSCQueue {
     return tail - head;
   }
 
+  T take(uint32_t index) {
+    T t{};
+    // It's possible that a push operation has obtained this index but hasn't
+    // yet written its value which will cause us to spin.
+    do {
+      t = buf_[index].exchange(t, std::memory_order::acq_rel);
+    } while (!t);
+
+    return t;
+  }
+
   std::optional<uint32_t> reserve_for_pop() {
     uint64_t expected;
     uint32_t head, tail;
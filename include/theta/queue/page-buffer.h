@@ -0,0 +1,159 @@
+#pragma once
+
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#include "theta/queue/defs.h"
+
+namespace theta {
+namespace internal {
+
+// A fixed array of n zero-filled Ts. The array's elements start out in that
+// all-zero state without being constructed, so T must be a type for which
+// zero bytes are a valid value.
+//
+// An array of at least a page lives in its own anonymous mapping, where the
+// kernel hands out zero-filled pages on first touch. A smaller one comes from
+// the heap, cache-line aligned and cleared with memset, since a mapping would
+// cost it a whole page and an mmap()/munmap() pair.
+//
+// prefault() and lock() take the page faults up front and keep the pages
+// resident, so that the first pass through a large buffer, or the first pass
+// after memory pressure, does not stall in the kernel. They need the mapping,
+// so a buffer that will use them is constructed with map_pages set.
+template <typename T>
+class PageBuffer {
+  static_assert(std::is_trivially_destructible_v<T>, "");
+  static_assert(alignof(T) <= hardware_destructive_interference_size, "");
+
+ public:
+  explicit PageBuffer(size_t n, bool map_pages = false)
+      : size_(n)
+      , mapped_(map_pages || n * sizeof(T) >= page_size())
+      , bytes_(mapped_ ? round_to_pages(n) : round_to_lines(n)) {
+    if (!mapped_) {
+      void* p = std::aligned_alloc(hardware_destructive_interference_size,
+                                   bytes_);
+      if (p == nullptr) {
+        throw std::bad_alloc{};
+      }
+      std::memset(p, 0, bytes_);
+      data_ = static_cast<T*>(p);
+      return;
+    }
+    void* p = mmap(nullptr,
+                   bytes_,
+                   PROT_READ | PROT_WRITE,
+                   MAP_PRIVATE | MAP_ANONYMOUS,
+                   /*fd=*/-1,
+                   /*offset=*/0);
+    if (p == MAP_FAILED) {
+      throw std::bad_alloc{};
+    }
+    data_ = static_cast<T*>(p);
+  }
+
+  PageBuffer(const PageBuffer&) = delete;
+  PageBuffer& operator=(const PageBuffer&) = delete;
+
+  ~PageBuffer() {
+    if (mapped_) {
+      munmap(data_, bytes_);
+    } else {
+      std::free(data_);
+    }
+  }
+
+  // True if the array has its own mapping rather than a heap allocation.
+  bool mapped() const { return mapped_; }
+
+  // Faults in every page for writing, splitting the range among num_threads
+  // threads. Faults on disjoint ranges of one mapping proceed in parallel.
+  // Requires mapped().
+  void prefault(size_t num_threads = 1) {
+    assert(mapped_);
+    const size_t page = page_size();
+    const size_t num_pages = bytes_ / page;
+    num_threads = std::clamp<size_t>(num_threads, 1, num_pages);
+    const size_t pages_per_thread = (num_pages + num_threads - 1) / num_threads;
+
+    auto prefault_range = [this, page](size_t first, size_t last) {
+      std::byte* begin = reinterpret_cast<std::byte*>(data_) + first * page;
+      size_t len = (last - first) * page;
+#ifdef MADV_POPULATE_WRITE
+      if (madvise(begin, len, MADV_POPULATE_WRITE) == 0) {
+        return;
+      }
+#endif
+      // Older kernels: write to one byte of each page. The pages hold zeros,
+      // and so does every byte written.
+      for (size_t offset = 0; offset < len; offset += page) {
+        *reinterpret_cast<volatile std::byte*>(begin + offset) = std::byte{0};
+      }
+    };
+
+    std::vector<std::thread> threads;
+    for (size_t first = pages_per_thread; first < num_pages;
+         first += pages_per_thread) {
+      threads.emplace_back(
+          prefault_range, first, std::min(first + pages_per_thread, num_pages));
+    }
+    prefault_range(0, std::min(pages_per_thread, num_pages));
+    for (auto& t : threads) {
+      t.join();
+    }
+  }
+
+  // Pins the pages in memory, faulting in any that are not resident yet.
+  // Returns false if the kernel refused, typically because of RLIMIT_MEMLOCK.
+  // Requires mapped().
+  bool lock() {
+    assert(mapped_);
+    locked_ = mlock(data_, bytes_) == 0;
+    return locked_;
+  }
+
+  bool locked() const { return locked_; }
+
+  T& operator[](size_t i) { return data_[i]; }
+  const T& operator[](size_t i) const { return data_[i]; }
+
+  T* data() { return data_; }
+  const T* data() const { return data_; }
+  size_t size() const { return size_; }
+
+ private:
+  const size_t size_;
+  const bool mapped_;
+  const size_t bytes_;
+  T* data_;
+  bool locked_{false};
+
+  static size_t page_size() {
+    static const size_t size = sysconf(_SC_PAGESIZE);
+    return size;
+  }
+
+  static size_t round_to_pages(size_t n) {
+    size_t page = page_size();
+    return std::max<size_t>((n * sizeof(T) + page - 1) / page, 1) * page;
+  }
+
+  static size_t round_to_lines(size_t n) {
+    constexpr size_t line = hardware_destructive_interference_size;
+    return std::max<size_t>((n * sizeof(T) + line - 1) / line, 1) * line;
+  }
+};
+
+}  // namespace internal
+}  // namespace theta
@@ -0,0 +1,245 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "theta/queue/defs.h"
+#include "theta/queue/mpsc-queue.h"
+#include "theta/queue/queue-opts.h"
+
+namespace theta {
+
+// A queue split into partitions by key, so that items with the same key are
+// consumed in the order they were pushed while items with different keys are
+// consumed in parallel.
+//
+// Each key hashes to one of num_partitions MPSCQueues. Consumers join() the
+// queue and each partition is assigned to one of them, round-robin over the
+// current members. When a consumer joins or leaves, the assignment changes
+// cooperatively: a consumer gives up a partition it no longer owns at the
+// start of its next poll(), and the new owner only starts reading it after
+// that, so a partition never has two consumers and nothing is reordered
+// across the handoff.
+//
+// lag() reports how many items each partition holds, for spotting hot keys
+// or slow consumers.
+template <ZeroableAtomType T>
+class PartitionedQueue {
+  static constexpr int32_t kNoOwner = -1;
+
+ public:
+  class Consumer;
+
+  PartitionedQueue(size_t num_partitions, QueueOpts opts)
+      : owners_(num_partitions), assigned_(num_partitions) {
+    for (size_t p = 0; p < num_partitions; p++) {
+      partitions_.push_back(std::make_unique<MPSCQueue<T>>(opts));
+      owners_[p].store(kNoOwner, std::memory_order::relaxed);
+      assigned_[p].store(kNoOwner, std::memory_order::relaxed);
+    }
+  }
+
+  PartitionedQueue(const PartitionedQueue&) = delete;
+  PartitionedQueue& operator=(const PartitionedQueue&) = delete;
+
+  // Every consumer must have left.
+  ~PartitionedQueue() = default;
+
+  size_t num_partitions() const { return partitions_.size(); }
+
+  template <typename Key>
+  size_t partition_of(const Key& key) const {
+    // std::hash is the identity for integers, so mix the bits before taking
+    // the remainder.
+    uint64_t h = std::hash<Key>{}(key);
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    return h % partitions_.size();
+  }
+
+  // Returns false if the key's partition is full.
+  template <typename Key>
+  bool try_push(const Key& key, T val) {
+    return partitions_[partition_of(key)]->try_push(val);
+  }
+
+  // Yields while the key's partition is full.
+  template <typename Key>
+  void push(const Key& key, T val) {
+    MPSCQueue<T>& partition = *partitions_[partition_of(key)];
+    while (!partition.try_push(val)) {
+      std::this_thread::yield();
+    }
+  }
+
+  // The number of items waiting in partition p.
+  size_t lag(size_t p) const { return partitions_[p]->size(); }
+
+  std::vector<size_t> lags() const {
+    std::vector<size_t> out;
+    for (size_t p = 0; p < partitions_.size(); p++) {
+      out.push_back(lag(p));
+    }
+    return out;
+  }
+
+  // Adds a consumer and rebalances the partitions over all consumers.
+  Consumer join() {
+    std::lock_guard lock{mu_};
+    int32_t id = 0;
+    while (static_cast<size_t>(id) < members_.size() && members_[id]) {
+      id++;
+    }
+    if (static_cast<size_t>(id) == members_.size()) {
+      members_.push_back(true);
+    } else {
+      members_[id] = true;
+    }
+    rebalance();
+    return Consumer{this, id};
+  }
+
+  // Reads the partitions currently assigned to it. Used by one thread at a
+  // time.
+  class Consumer {
+   public:
+    Consumer(Consumer&& other)
+        : queue_(std::exchange(other.queue_, nullptr))
+        , id_(other.id_)
+        , generation_(other.generation_)
+        , partitions_(std::move(other.partitions_))
+        , next_(other.next_) {}
+
+    Consumer(const Consumer&) = delete;
+    Consumer& operator=(const Consumer&) = delete;
+    Consumer& operator=(Consumer&&) = delete;
+
+    // Leaves the queue, handing this consumer's partitions to the others.
+    ~Consumer() {
+      if (queue_) {
+        queue_->leave(id_);
+      }
+    }
+
+    // Passes up to budget items from this consumer's partitions to fn,
+    // starting where the previous poll() stopped. Returns the number of items
+    // passed.
+    template <typename Fn>
+    size_t poll(Fn&& fn, size_t budget = 64) {
+      queue_->refresh(*this);
+      size_t total = 0;
+      for (size_t i = 0; i < partitions_.size() && total < budget; i++) {
+        size_t p = partitions_[next_];
+        next_ = (next_ + 1) % partitions_.size();
+        if (!queue_->claim(p, id_)) {
+          continue;
+        }
+        MPSCQueue<T>& partition = *queue_->partitions_[p];
+        while (total < budget) {
+          auto val = partition.try_pop();
+          if (!val) {
+            break;
+          }
+          fn(*val);
+          total++;
+        }
+      }
+      return total;
+    }
+
+    // The partitions assigned to this consumer as of its last poll(). Some
+    // may still be held by their previous owner.
+    const std::vector<size_t>& partitions() const { return partitions_; }
+
+   private:
+    friend class PartitionedQueue;
+
+    Consumer(PartitionedQueue* queue, int32_t id) : queue_(queue), id_(id) {}
+
+    PartitionedQueue* queue_;
+    int32_t id_;
+    // Zero is never current: every join() and leave() advances it.
+    uint64_t generation_{0};
+    std::vector<size_t> partitions_;
+    size_t next_{0};
+  };
+
+ private:
+  std::vector<std::unique_ptr<MPSCQueue<T>>> partitions_;
+  // The consumer reading each partition, or kNoOwner. A partition changes
+  // hands only through kNoOwner.
+  std::vector<std::atomic<int32_t>> owners_;
+  // The consumer each partition should move to.
+  std::vector<std::atomic<int32_t>> assigned_;
+  alignas(hardware_destructive_interference_size)
+      std::atomic<uint64_t> generation_{0};
+  std::mutex mu_;
+  std::vector<bool> members_;
+
+  // Requires mu_.
+  void rebalance() {
+    std::vector<int32_t> active;
+    for (size_t id = 0; id < members_.size(); id++) {
+      if (members_[id]) {
+        active.push_back(id);
+      }
+    }
+    for (size_t p = 0; p < partitions_.size(); p++) {
+      assigned_[p].store(active.empty() ? kNoOwner : active[p % active.size()],
+                         std::memory_order::relaxed);
+    }
+    generation_.fetch_add(1, std::memory_order::release);
+  }
+
+  void leave(int32_t id) {
+    std::lock_guard lock{mu_};
+    for (auto& owner : owners_) {
+      if (owner.load(std::memory_order::relaxed) == id) {
+        owner.store(kNoOwner, std::memory_order::release);
+      }
+    }
+    members_[id] = false;
+    rebalance();
+  }
+
+  // Picks up a new assignment, releasing partitions that moved elsewhere.
+  // Called between polls, when the consumer holds no item from any
+  // partition.
+  void refresh(Consumer& consumer) {
+    if (generation_.load(std::memory_order::acquire) == consumer.generation_) {
+      return;
+    }
+    std::lock_guard lock{mu_};
+    consumer.partitions_.clear();
+    for (size_t p = 0; p < partitions_.size(); p++) {
+      if (assigned_[p].load(std::memory_order::relaxed) == consumer.id_) {
+        consumer.partitions_.push_back(p);
+      } else if (owners_[p].load(std::memory_order::relaxed) == consumer.id_) {
+        owners_[p].store(kNoOwner, std::memory_order::release);
+      }
+    }
+    consumer.next_ = 0;
+    consumer.generation_ = generation_.load(std::memory_order::relaxed);
+  }
+
+  // Fails while the previous owner still holds the partition.
+  bool claim(size_t p, int32_t id) {
+    int32_t owner = owners_[p].load(std::memory_order::relaxed);
+    if (owner == id) {
+      return true;
+    }
+    return owner == kNoOwner
+        && owners_[p].compare_exchange_strong(
+               owner, id, std::memory_order::acquire);
+  }
+};
+
+}  // namespace theta
@@ -0,0 +1,144 @@
+#pragma once
+
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <chrono>
+#include <climits>
+#include <cstdint>
+
+#include "theta/queue/defs.h"
+
+namespace theta {
+
+namespace internal {
+
+inline void futex_wait(std::atomic<uint32_t>* addr, uint32_t expected) {
+  syscall(SYS_futex,
+          reinterpret_cast<uint32_t*>(addr),
+          FUTEX_WAIT_PRIVATE,
+          expected,
+          nullptr,
+          nullptr,
+          0);
+}
+
+inline void futex_wake(std::atomic<uint32_t>* addr, int num_waiters) {
+  syscall(SYS_futex,
+          reinterpret_cast<uint32_t*>(addr),
+          FUTEX_WAKE_PRIVATE,
+          num_waiters,
+          nullptr,
+          nullptr,
+          0);
+}
+
+// This and the two functions below are for futex words that are half of a
+// wider atomic, such as the tag of a queue slot. Returns after a wakeup, or
+// at once if *addr != expected.
+inline void futex_wait(const void* addr, uint32_t expected) {
+  syscall(SYS_futex,
+          addr,
+          FUTEX_WAIT_PRIVATE,
+          expected,
+          nullptr,
+          nullptr,
+          0);
+}
+
+// As futex_wait(), but also returns once timeout has passed.
+inline void futex_wait_for(const void* addr,
+                           uint32_t expected,
+                           std::chrono::nanoseconds timeout) {
+  auto secs = std::chrono::duration_cast<std::chrono::seconds>(timeout);
+  timespec ts{.tv_sec = static_cast<time_t>(secs.count()),
+              .tv_nsec = static_cast<long>((timeout - secs).count())};
+  syscall(SYS_futex,
+          addr,
+          FUTEX_WAIT_PRIVATE,
+          expected,
+          &ts,
+          nullptr,
+          0);
+}
+
+inline void futex_wake_all(const void* addr) {
+  syscall(SYS_futex,
+          addr,
+          FUTEX_WAKE_PRIVATE,
+          INT_MAX,
+          nullptr,
+          nullptr,
+          0);
+}
+
+}  // namespace internal
+
+// An eventcount that a queue signals after every push while someone is
+// waiting for it to become non-empty. The epoch is a 32-bit futex word so that
+// several events can be waited on at once with futex_waitv(2).
+//
+// A waiter calls prepare_wait(), re-checks its condition, and then either
+// calls cancel_wait() or wait() with the epoch that prepare_wait() returned.
+class QueueEvent {
+ public:
+  uint32_t prepare_wait() {
+    waiters_.fetch_add(1, std::memory_order::seq_cst);
+    return epoch_.load(std::memory_order::seq_cst);
+  }
+
+  void cancel_wait() { waiters_.fetch_sub(1, std::memory_order::relaxed); }
+
+  void wait(uint32_t epoch) {
+    internal::futex_wait(&epoch_, epoch);
+    cancel_wait();
+  }
+
+  // As wait(), but also returns once timeout has passed.
+  void wait_for(uint32_t epoch, std::chrono::nanoseconds timeout) {
+    internal::futex_wait_for(&epoch_, epoch, timeout);
+    cancel_wait();
+  }
+
+  // Called after the state change has been published with a seq_cst
+  // operation. This is a single load unless someone is waiting. Every waiter
+  // of an event is interested in the same queue, so one wakeup per push is
+  // enough.
+  void notify() { wake(/*num_waiters=*/1); }
+
+  void notify_all() { wake(/*num_waiters=*/INT_MAX); }
+
+  // A process-wide event that every notify() also signals while it has
+  // waiters. wait_any() falls back to it when futex_waitv is unavailable.
+  static QueueEvent& shared() {
+    static QueueEvent event;
+    return event;
+  }
+
+  std::atomic<uint32_t>* futex_word() { return &epoch_; }
+
+ private:
+  alignas(hardware_destructive_interference_size)
+      std::atomic<uint32_t> epoch_{0};
+  std::atomic<uint32_t> waiters_{0};
+
+  void wake(int num_waiters) {
+    if (waiters_.load(std::memory_order::seq_cst) == 0) {
+      return;
+    }
+    epoch_.fetch_add(1, std::memory_order::seq_cst);
+    internal::futex_wake(&epoch_, num_waiters);
+
+    // Waiters on the shared event may be watching unrelated queues.
+    QueueEvent& fallback = shared();
+    if (this != &fallback
+        && fallback.waiters_.load(std::memory_order::seq_cst) > 0) {
+      fallback.notify_all();
+    }
+  }
+};
+
+}  // namespace theta
@@ -1,7 +1,14 @@
 #pragma once
 
+#include <cassert>
+#include <chrono>
+
 #include "defs.h"
 
+namespace theta {
+class ReadinessNotifier;
+}  // namespace theta
+
 class QueueOpts {
  public:
   size_t max_size() const { return max_size_; }
@@ -10,6 +17,72 @@ class QueueOpts {
     return *this;
   }
 
+  // If set, the queue signals this notifier on empty to non-empty transitions.
+  // The notifier must outlive the queue.
+  theta::ReadinessNotifier* readiness_notifier() const {
+    return readiness_notifier_;
+  }
+  QueueOpts& set_readiness_notifier(theta::ReadinessNotifier* val) {
+    readiness_notifier_ = val;
+    return *this;
+  }
+
+  // If max_items > 1, MPMCQueue defers waking consumers that are blocked in
+  // pop() until max_items wakeups are pending, or until max_delay has passed
+  // since the first of them was deferred, whichever comes first. The queue
+  // then starts a helper thread that flushes batches whose deadline passes
+  // with no push to flush them. max_delay must be positive.
+  size_t wakeup_batch_size() const { return wakeup_batch_size_; }
+  std::chrono::nanoseconds wakeup_batch_delay() const {
+    return wakeup_batch_delay_;
+  }
+  QueueOpts& set_wakeup_batching(size_t max_items,
+                                 std::chrono::nanoseconds max_delay) {
+    assert(max_items <= 1 || max_delay > std::chrono::nanoseconds::zero());
+    wakeup_batch_size_ = max_items;
+    wakeup_batch_delay_ = max_delay;
+    return *this;
+  }
+
+  // If num_threads > 0, MPMCQueue faults in every page of its slot array at
+  // construction, using that many threads.
+  size_t prefault_threads() const { return prefault_threads_; }
+  QueueOpts& set_prefault(size_t num_threads = 1) {
+    prefault_threads_ = num_threads;
+    return *this;
+  }
+
+  // If set, MPMCQueue mlock()s its slot array so that it is never paged out.
+  // Locking is best effort; see MPMCQueue::memory_locked().
+  bool lock_memory() const { return lock_memory_; }
+  QueueOpts& set_lock_memory(bool val) {
+    lock_memory_ = val;
+    return *this;
+  }
+
+  // CoDelQueue drops items from the head once their time in the queue has
+  // stayed above target for at least interval. If reject is set, pushes also
+  // fail while it is dropping.
+  std::chrono::microseconds codel_target() const { return codel_target_; }
+  std::chrono::microseconds codel_interval() const { return codel_interval_; }
+  bool codel_reject() const { return codel_reject_; }
+  QueueOpts& set_codel(std::chrono::microseconds target,
+                       std::chrono::microseconds interval,
+                       bool reject = false) {
+    codel_target_ = target;
+    codel_interval_ = interval;
+    codel_reject_ = reject;
+    return *this;
+  }
+
  private:
   size_t max_size_{hardware_destructive_interference_size};
+  theta::ReadinessNotifier* readiness_notifier_{nullptr};
+  size_t wakeup_batch_size_{1};
+  std::chrono::nanoseconds wakeup_batch_delay_{0};
+  size_t prefault_threads_{0};
+  bool lock_memory_{false};
+  std::chrono::microseconds codel_target_{5000};
+  std::chrono::microseconds codel_interval_{100000};
+  bool codel_reject_{false};
 };
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <fcntl.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <cassert>
+#include <cerrno>
+#include <cstdint>
+#include <system_error>
+
+#include "theta/queue/defs.h"
+
+namespace theta {
+
+// A file descriptor that becomes readable when a queue goes from empty to
+// non-empty, so that a reactor can multiplex queues with sockets in epoll.
+//
+// Writes are coalesced: once the fd has been signaled, producers skip the
+// syscall until the consumer drains the queue and re-arms the notifier through
+// the queue's arm_notifier(). The consumer loop is:
+//
+//   on readable(notifier.fd()):
+//     notifier.consume();
+//     do {
+//       while (auto v = queue.try_pop()) { ... }
+//     } while (!queue.arm_notifier());
+//
+// An eventfd is used when available, with a non-blocking pipe as a fallback.
+class ReadinessNotifier {
+ public:
+  ReadinessNotifier() {
+    read_fd_ = write_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (read_fd_ < 0) {
+      int fds[2];
+      if (pipe2(fds, O_NONBLOCK | O_CLOEXEC) != 0) {
+        throw std::system_error{errno, std::system_category(), "pipe2"};
+      }
+      read_fd_ = fds[0];
+      write_fd_ = fds[1];
+    }
+  }
+
+  ReadinessNotifier(const ReadinessNotifier&) = delete;
+  ReadinessNotifier& operator=(const ReadinessNotifier&) = delete;
+
+  ~ReadinessNotifier() {
+    close(read_fd_);
+    if (write_fd_ != read_fd_) {
+      close(write_fd_);
+    }
+  }
+
+  // The descriptor to register for EPOLLIN.
+  int fd() const { return read_fd_; }
+
+  // Called by producers after an item is published. The caller must have
+  // published the item with a seq_cst (or asymmetric light barrier ordered)
+  // operation.
+  void notify() {
+    if (signaled_.load(std::memory_order::seq_cst)) {
+      return;
+    }
+    if (!signaled_.exchange(true, std::memory_order::acq_rel)) {
+      uint64_t one = 1;
+      ssize_t n = write(write_fd_, &one, is_eventfd() ? sizeof(one) : 1);
+      // A full pipe or saturated eventfd is already readable.
+      assert(n > 0 || errno == EAGAIN);
+      (void)n;
+    }
+  }
+
+  // Clears the fd's readability. Call after the reactor reports it readable.
+  void consume() {
+    uint64_t buf[8];
+    while (read(read_fd_, buf, sizeof(buf)) > 0) {
+    }
+  }
+
+  // Allows the next notify() to signal the fd again. The caller must re-check
+  // the queue after a full fence; the queues wrap this in arm_notifier().
+  void arm() { signaled_.store(false, std::memory_order::seq_cst); }
+
+ private:
+  int read_fd_;
+  int write_fd_;
+  alignas(hardware_destructive_interference_size)
+      std::atomic<bool> signaled_{false};
+
+  bool is_eventfd() const { return read_fd_ == write_fd_; }
+};
+
+}  // namespace theta
@@ -0,0 +1,178 @@
+#pragma once
+
+#include <atomic>
+#include <bit>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "theta/queue/defs.h"
+#include "theta/queue/mpsc-queue.h"
+#include "theta/queue/queue-event.h"
+#include "theta/queue/queue-opts.h"
+
+namespace theta {
+
+// A set of indices that producers mark ready and a single consumer takes, for
+// a dispatcher that serves many queues.
+//
+// The set is a hierarchical bitmap: bit i of a leaf word marks index i, and
+// bit j of a word one level up marks that word j of the level below may be
+// non-zero. set() walks up only until it reaches a word that was already
+// non-zero, and take_all() descends only into marked words, using ctz to
+// find each set bit. Finding the ready indices therefore costs time
+// proportional to their number rather than to the size of the set.
+//
+// A word is non-zero only if its bit in the parent is set or the consumer is
+// about to take it: the consumer clears a parent bit before it exchanges the
+// child word, and a producer that finds the child word zero sets the parent
+// bit again.
+class ReadySet {
+ public:
+  explicit ReadySet(size_t size) : size_(size) {
+    size_t words = size;
+    do {
+      words = (words + 63) / 64;
+      levels_.emplace_back(new Word[words]);
+    } while (words > 1);
+  }
+
+  ReadySet(const ReadySet&) = delete;
+  ReadySet& operator=(const ReadySet&) = delete;
+
+  size_t size() const { return size_; }
+
+  // Marks index ready. Any thread.
+  void set(size_t index) {
+    assert(index < size_);
+    for (auto& level : levels_) {
+      uint64_t bit = uint64_t{1} << (index % 64);
+      index /= 64;
+      // seq_cst so that a consumer that re-checks any() after
+      // QueueEvent::prepare_wait() cannot miss this.
+      uint64_t old
+          = level[index].bits.fetch_or(bit, std::memory_order::seq_cst);
+      if (old != 0) {
+        return;
+      }
+    }
+    ready_event_.notify();
+  }
+
+  // Consumer only. Clears every ready index and passes each to fn, in
+  // ascending order. Returns the number of indices taken.
+  template <typename Fn>
+  size_t take_all(Fn&& fn) {
+    return take(levels_.size() - 1, /*word=*/0, fn);
+  }
+
+  // True if some index may be ready.
+  bool any() const {
+    return levels_.back()[0].bits.load(std::memory_order::seq_cst) != 0;
+  }
+
+  // Signaled when the set goes from empty to non-empty.
+  QueueEvent& ready_event() { return ready_event_; }
+
+ private:
+  struct alignas(hardware_constructive_interference_size) Word {
+    std::atomic<uint64_t> bits{0};
+  };
+
+  const size_t size_;
+  // Leaves first; the last level is a single word.
+  std::vector<std::unique_ptr<Word[]>> levels_;
+  QueueEvent ready_event_;
+
+  template <typename Fn>
+  size_t take(size_t level, size_t word, Fn& fn) {
+    uint64_t bits
+        = levels_[level][word].bits.exchange(0, std::memory_order::acq_rel);
+    size_t n = 0;
+    for (; bits; bits &= bits - 1) {
+      size_t index = word * 64 + std::countr_zero(bits);
+      if (level == 0) {
+        fn(index);
+        n++;
+      } else {
+        n += take(level - 1, index, fn);
+      }
+    }
+    return n;
+  }
+};
+
+// A fixed set of MPSCQueue inboxes served by one dispatcher thread. A push
+// that makes an inbox non-empty marks it in a ReadySet, so dispatch() visits
+// only inboxes that have items.
+template <ZeroableAtomType T>
+class InboxSet {
+ public:
+  InboxSet(size_t num_inboxes, QueueOpts opts) : ready_(num_inboxes) {
+    for (size_t i = 0; i < num_inboxes; i++) {
+      inboxes_.push_back(std::make_unique<MPSCQueue<T>>(opts));
+    }
+  }
+
+  size_t num_inboxes() const { return inboxes_.size(); }
+
+  // Returns false if the inbox is full.
+  bool try_push(size_t inbox, T val) {
+    size_t num_items;
+    if (!inboxes_[inbox]->try_push(val, &num_items)) {
+      return false;
+    }
+    if (num_items == 1) {
+      ready_.set(inbox);
+    }
+    return true;
+  }
+
+  // Dispatcher only. Pops up to budget items from each ready inbox and
+  // passes them to fn(inbox, item). An inbox that still has items afterwards
+  // stays ready. Returns the number of items dispatched.
+  template <typename Fn>
+  size_t dispatch(Fn&& fn, size_t budget = SIZE_MAX) {
+    size_t total = 0;
+    ready_.take_all([&](size_t inbox) {
+      MPSCQueue<T>& queue = *inboxes_[inbox];
+      size_t n = 0;
+      while (n < budget) {
+        auto val = queue.try_pop();
+        if (!val) {
+          break;
+        }
+        fn(inbox, *val);
+        n++;
+      }
+      // Pushes that found the inbox non-empty relied on this pass.
+      if (n == budget || queue.size() > 0) {
+        ready_.set(inbox);
+      }
+      total += n;
+    });
+    return total;
+  }
+
+  // Blocks until some inbox may be ready.
+  void wait() {
+    while (!ready_.any()) {
+      uint32_t epoch = ready_.ready_event().prepare_wait();
+      if (ready_.any()) {
+        ready_.ready_event().cancel_wait();
+        return;
+      }
+      ready_.ready_event().wait(epoch);
+    }
+  }
+
+  MPSCQueue<T>& inbox(size_t i) { return *inboxes_[i]; }
+
+ private:
+  std::vector<std::unique_ptr<MPSCQueue<T>>> inboxes_;
+  ReadySet ready_;
+};
+
+}  // namespace theta
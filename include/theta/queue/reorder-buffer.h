@@ -0,0 +1,92 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <thread>
+#include <type_traits>
+
+#include "theta/queue/defs.h"
+
+namespace theta {
+
+// Puts items that finished out of order back into sequence order, for
+// workers that process items from a queue in parallel. MPMCQueue::pop(&seq)
+// provides the sequence numbers.
+//
+// Workers insert each finished item into slot seq % kCapacity, and a single
+// sequencer passes on the run of consecutive items that starts at the next
+// sequence number it expects. A worker whose item is kCapacity or more ahead
+// of the sequencer has to wait, which bounds how far the workers can run
+// ahead.
+template <typename T, size_t kCapacity = 1024>
+  requires std::is_trivially_copyable_v<T>
+class ReorderBuffer {
+  static_assert((kCapacity & (kCapacity - 1)) == 0, "");
+
+ public:
+  ReorderBuffer() = default;
+  ReorderBuffer(const ReorderBuffer&) = delete;
+  ReorderBuffer& operator=(const ReorderBuffer&) = delete;
+
+  static constexpr size_t capacity() { return kCapacity; }
+
+  // Returns false if seq is too far ahead of the sequencer. Each sequence
+  // number must be inserted exactly once.
+  bool try_insert(uint64_t seq, T val) {
+    if (seq - next_.load(std::memory_order::acquire) >= kCapacity) {
+      return false;
+    }
+    Slot& slot = slots_[seq % kCapacity];
+    slot.value = val;
+    slot.seq.store(seq + 1, std::memory_order::release);
+    return true;
+  }
+
+  // Yields while seq is too far ahead of the sequencer.
+  void insert(uint64_t seq, T val) {
+    while (!try_insert(seq, val)) {
+      std::this_thread::yield();
+    }
+  }
+
+  // Sequencer only. Passes up to max_items items to fn in sequence order,
+  // stopping at the first sequence number that has not been inserted yet.
+  // Returns the number of items passed.
+  template <typename Fn>
+  size_t drain(Fn&& fn, size_t max_items = SIZE_MAX) {
+    uint64_t next = next_.load(std::memory_order::relaxed);
+    size_t n = 0;
+    while (n < max_items) {
+      Slot& slot = slots_[next % kCapacity];
+      if (slot.seq.load(std::memory_order::acquire) != next + 1) {
+        break;
+      }
+      fn(slot.value);
+      next++;
+      n++;
+    }
+    if (n > 0) {
+      // Frees the drained slots for workers that are further ahead.
+      next_.store(next, std::memory_order::release);
+    }
+    return n;
+  }
+
+  // The next sequence number the sequencer will pass on.
+  uint64_t next_seq() const { return next_.load(std::memory_order::acquire); }
+
+ private:
+  struct Slot {
+    // One more than the sequence number of the item in value, so that the
+    // zero-initialized slot holds nothing.
+    std::atomic<uint64_t> seq{0};
+    T value;
+  };
+
+  alignas(hardware_destructive_interference_size)
+      std::atomic<uint64_t> next_{0};
+  alignas(hardware_destructive_interference_size) Slot slots_[kCapacity];
+};
+
+}  // namespace theta
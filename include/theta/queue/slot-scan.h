@@ -0,0 +1,156 @@
+#pragma once
+
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define THETA_QUEUE_X86_SCAN 1
+#endif
+
+namespace theta {
+namespace internal {
+
+// Counts the leading slots whose tags match, for scanning runs of ready slots
+// in a queue buffer. Slot i is the kStride 64-bit words starting at
+// words[i * kStride], the last of which is its tag, and it matches if
+// (tag & mask) == expected + i * step. Returns the length of the matching
+// prefix, at most n.
+//
+// The words are read with plain vector loads, so the result is only a hint:
+// the caller must still read each slot it acts on atomically.
+template <size_t kStride>
+size_t scan_tags_scalar(const uint64_t* words,
+                        size_t n,
+                        uint64_t mask,
+                        uint64_t expected,
+                        uint64_t step) {
+  size_t i = 0;
+  while (i < n
+         && (words[i * kStride + kStride - 1] & mask) == expected + i * step) {
+    i++;
+  }
+  return i;
+}
+
+#ifdef THETA_QUEUE_X86_SCAN
+
+template <size_t kStride>
+__attribute__((target("sse4.1"))) size_t scan_tags_sse(const uint64_t* words,
+                                                         size_t n,
+                                                         uint64_t mask,
+                                                         uint64_t expected,
+                                                         uint64_t step) {
+  const __m128i mask_v = _mm_set1_epi64x(mask);
+  const __m128i step_v = _mm_set1_epi64x(2 * step);
+  __m128i expected_v = _mm_set_epi64x(expected + step, expected);
+
+  size_t i = 0;
+  for (; i + 2 <= n; i += 2) {
+    __m128i tags;
+    if constexpr (kStride == 1) {
+      tags = _mm_loadu_si128(reinterpret_cast<const __m128i*>(words + i));
+    } else {
+      static_assert(kStride == 2);
+      __m128i a
+          = _mm_loadu_si128(reinterpret_cast<const __m128i*>(words + 2 * i));
+      __m128i b = _mm_loadu_si128(
+          reinterpret_cast<const __m128i*>(words + 2 * i + 2));
+      tags = _mm_unpackhi_epi64(a, b);
+    }
+    __m128i eq = _mm_cmpeq_epi64(_mm_and_si128(tags, mask_v), expected_v);
+    unsigned bits = _mm_movemask_pd(_mm_castsi128_pd(eq));
+    if (bits != 0b11) {
+      return i + std::countr_one(bits);
+    }
+    expected_v = _mm_add_epi64(expected_v, step_v);
+  }
+  return i
+       + scan_tags_scalar<kStride>(
+             words + i * kStride, n - i, mask, expected + i * step, step);
+}
+
+template <size_t kStride>
+__attribute__((target("avx2"))) size_t scan_tags_avx2(const uint64_t* words,
+                                                       size_t n,
+                                                       uint64_t mask,
+                                                       uint64_t expected,
+                                                       uint64_t step) {
+  const __m256i mask_v = _mm256_set1_epi64x(mask);
+  const __m256i step_v = _mm256_set1_epi64x(4 * step);
+  __m256i expected_v = _mm256_set_epi64x(
+      expected + 3 * step, expected + 2 * step, expected + step, expected);
+
+  size_t i = 0;
+  for (; i + 4 <= n; i += 4) {
+    __m256i tags;
+    if constexpr (kStride == 1) {
+      tags = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(words + i));
+    } else {
+      static_assert(kStride == 2);
+      __m256i a
+          = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(words + 2 * i));
+      __m256i b = _mm256_loadu_si256(
+          reinterpret_cast<const __m256i*>(words + 2 * i + 4));
+      // [t0, t2, t1, t3] -> [t0, t1, t2, t3]
+      tags = _mm256_permute4x64_epi64(_mm256_unpackhi_epi64(a, b),
+                                      _MM_SHUFFLE(3, 1, 2, 0));
+    }
+    __m256i eq
+        = _mm256_cmpeq_epi64(_mm256_and_si256(tags, mask_v), expected_v);
+    unsigned bits = _mm256_movemask_pd(_mm256_castsi256_pd(eq));
+    if (bits != 0b1111) {
+      return i + std::countr_one(bits);
+    }
+    expected_v = _mm256_add_epi64(expected_v, step_v);
+  }
+  return i
+       + scan_tags_scalar<kStride>(
+             words + i * kStride, n - i, mask, expected + i * step, step);
+}
+
+#endif  // THETA_QUEUE_X86_SCAN
+
+enum class ScanImpl { kScalar, kSse, kAvx2 };
+
+inline ScanImpl best_scan_impl() {
+#ifdef THETA_QUEUE_X86_SCAN
+  static const ScanImpl impl = []() {
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+      return ScanImpl::kAvx2;
+    }
+    if (__builtin_cpu_supports("sse4.1")) {
+      return ScanImpl::kSse;
+    }
+    return ScanImpl::kScalar;
+  }();
+  return impl;
+#else
+  return ScanImpl::kScalar;
+#endif
+}
+
+template <size_t kStride>
+size_t scan_tags(const uint64_t* words,
+                 size_t n,
+                 uint64_t mask,
+                 uint64_t expected,
+                 uint64_t step,
+                 ScanImpl impl = best_scan_impl()) {
+#ifdef THETA_QUEUE_X86_SCAN
+  switch (impl) {
+    case ScanImpl::kAvx2:
+      return scan_tags_avx2<kStride>(words, n, mask, expected, step);
+    case ScanImpl::kSse:
+      return scan_tags_sse<kStride>(words, n, mask, expected, step);
+    case ScanImpl::kScalar:
+      break;
+  }
+#endif
+  return scan_tags_scalar<kStride>(words, n, mask, expected, step);
+}
+
+}  // namespace internal
+}  // namespace theta
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <utility>
+
+#include "theta/queue/defs.h"
+
+namespace theta {
+
+// A bounded single-producer, single-consumer ring.
+//
+// The producer's index and its cached copy of the consumer's index share one
+// cache line, and the consumer's index and its cached copy of the producer's
+// share another, so each side only reads the other's line when its cached
+// copy says the ring is full or empty. Batched pushes and pops publish a whole
+// batch with one store.
+template <typename T, size_t kCapacity = 1024>
+class SPSCRing {
+  static_assert((kCapacity & (kCapacity - 1)) == 0, "");
+  static constexpr uint64_t kMask = kCapacity - 1;
+
+ public:
+  SPSCRing() : buf_(new T[kCapacity]) {}
+
+  SPSCRing(const SPSCRing&) = delete;
+  SPSCRing& operator=(const SPSCRing&) = delete;
+
+  // Producer only. Moves up to n items from items into the ring and returns
+  // the number moved.
+  size_t try_push_n(T* items, size_t n) {
+    uint64_t tail = producer_.tail.load(std::memory_order::relaxed);
+    if (kCapacity - (tail - producer_.cached_head) < n) {
+      producer_.cached_head = consumer_.head.load(std::memory_order::acquire);
+    }
+    n = std::min<size_t>(n, kCapacity - (tail - producer_.cached_head));
+    for (size_t i = 0; i < n; i++) {
+      buf_[(tail + i) & kMask] = std::move(items[i]);
+    }
+    if (n > 0) {
+      producer_.tail.store(tail + n, std::memory_order::release);
+    }
+    return n;
+  }
+
+  // Producer only.
+  bool try_push(T item) { return try_push_n(&item, 1) == 1; }
+
+  // Consumer only. Passes up to max_items items to fn, oldest first, and
+  // returns the number passed. fn may move from its argument.
+  template <typename Fn>
+  size_t consume(Fn&& fn, size_t max_items = kCapacity) {
+    uint64_t head = consumer_.head.load(std::memory_order::relaxed);
+    if (consumer_.cached_tail == head) {
+      consumer_.cached_tail = producer_.tail.load(std::memory_order::acquire);
+    }
+    size_t n = std::min<size_t>(max_items, consumer_.cached_tail - head);
+    for (size_t i = 0; i < n; i++) {
+      fn(buf_[(head + i) & kMask]);
+    }
+    if (n > 0) {
+      consumer_.head.store(head + n, std::memory_order::release);
+    }
+    return n;
+  }
+
+  // Exact when called by either side while the other is idle.
+  size_t size() const {
+    return producer_.tail.load(std::memory_order::acquire)
+         - consumer_.head.load(std::memory_order::acquire);
+  }
+
+  bool empty() const { return size() == 0; }
+
+  static constexpr size_t capacity() { return kCapacity; }
+
+ private:
+  struct alignas(hardware_destructive_interference_size) ProducerSide {
+    std::atomic<uint64_t> tail{0};
+    uint64_t cached_head{0};
+  };
+  struct alignas(hardware_destructive_interference_size) ConsumerSide {
+    std::atomic<uint64_t> head{0};
+    uint64_t cached_tail{0};
+  };
+
+  ProducerSide producer_;
+  ConsumerSide consumer_;
+  std::unique_ptr<T[]> buf_;
+};
+
+}  // namespace theta
@@ -0,0 +1,325 @@
+#pragma once
+
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <thread>
+#include <type_traits>
+#include <utility>
+
+#include "theta/queue/defs.h"
+#include "theta/queue/queue-event.h"
+
+namespace theta {
+
+// A type-erased void() callable that stores captures of up to kInlineSize
+// bytes in place and larger ones on the heap. Move-only.
+//
+// The buffer is only pointer-aligned, so that with the vtable pointer it
+// packs into sizeof(void*) + kInlineSize bytes; the rare capture that needs
+// more alignment goes on the heap.
+template <size_t kInlineSize>
+class InlineTask {
+  struct VTable {
+    void (*invoke)(void* storage);
+    // Move-constructs into dst and destroys src.
+    void (*relocate)(void* dst, void* src);
+    void (*destroy)(void* storage);
+  };
+
+  template <typename F>
+  static constexpr bool kFitsInline
+      = sizeof(F) <= kInlineSize && alignof(F) <= alignof(void*)
+     && std::is_nothrow_move_constructible_v<F>;
+
+  template <typename F>
+  static constexpr VTable kInlineVTable{
+      .invoke = [](void* s) { (*std::launder(static_cast<F*>(s)))(); },
+      .relocate =
+          [](void* dst, void* src) {
+            F* f = std::launder(static_cast<F*>(src));
+            new (dst) F(std::move(*f));
+            f->~F();
+          },
+      .destroy = [](void* s) { std::launder(static_cast<F*>(s))->~F(); },
+  };
+
+  template <typename F>
+  static constexpr VTable kHeapVTable{
+      .invoke = [](void* s) { (**static_cast<F**>(s))(); },
+      .relocate =
+          [](void* dst, void* src) {
+            *static_cast<F**>(dst) = *static_cast<F**>(src);
+          },
+      .destroy = [](void* s) { delete *static_cast<F**>(s); },
+  };
+
+ public:
+  static_assert(kInlineSize >= sizeof(void*), "");
+
+  InlineTask() = default;
+
+  template <typename F>
+    requires(!std::is_same_v<std::decay_t<F>, InlineTask>
+             && std::is_invocable_v<std::decay_t<F>&>)
+  InlineTask(F&& f) {
+    emplace(std::forward<F>(f));
+  }
+
+  InlineTask(InlineTask&& other) : vtable_(other.vtable_) {
+    if (vtable_) {
+      vtable_->relocate(storage_, other.storage_);
+      other.vtable_ = nullptr;
+    }
+  }
+
+  InlineTask& operator=(InlineTask&& other) {
+    if (this != &other) {
+      reset();
+      if (other.vtable_) {
+        other.vtable_->relocate(storage_, other.storage_);
+        vtable_ = std::exchange(other.vtable_, nullptr);
+      }
+    }
+    return *this;
+  }
+
+  InlineTask(const InlineTask&) = delete;
+  InlineTask& operator=(const InlineTask&) = delete;
+
+  ~InlineTask() { reset(); }
+
+  explicit operator bool() const { return vtable_ != nullptr; }
+
+  void operator()() {
+    assert(vtable_);
+    vtable_->invoke(storage_);
+  }
+
+  // Replaces the stored callable with f, constructed in place.
+  template <typename F>
+    requires(!std::is_same_v<std::decay_t<F>, InlineTask>
+             && std::is_invocable_v<std::decay_t<F>&>)
+  void emplace(F&& f) {
+    reset();
+    using Fn = std::decay_t<F>;
+    if constexpr (kFitsInline<Fn>) {
+      new (storage_) Fn(std::forward<F>(f));
+      vtable_ = &kInlineVTable<Fn>;
+    } else {
+      *reinterpret_cast<Fn**>(storage_) = new Fn(std::forward<F>(f));
+      vtable_ = &kHeapVTable<Fn>;
+    }
+  }
+
+  void reset() {
+    if (vtable_) {
+      vtable_->destroy(storage_);
+      vtable_ = nullptr;
+    }
+  }
+
+  // True if a callable of type F is stored without a heap allocation.
+  template <typename F>
+  static constexpr bool stores_inline() {
+    return kFitsInline<std::decay_t<F>>;
+  }
+
+ private:
+  const VTable* vtable_{nullptr};
+  alignas(void*) std::byte storage_[kInlineSize];
+};
+
+// A bounded multiple-producer, multiple-consumer queue of InlineTasks. Each
+// slot holds the task itself, so submitting a task with a small capture does
+// not allocate.
+//
+// Slots carry a sequence number (as in Dmitry Vyukov's bounded MPMC queue): a
+// slot at position p is free for the producer of p when its sequence is p, and
+// holds that producer's task when its sequence is p + 1. A consumer moves the
+// task out and sets the sequence to p + kCapacity, handing the slot to the
+// producer of the next lap before the task runs.
+//
+// With the default kInlineSize, a slot (the sequence, the vtable pointer, and
+// 48 bytes of captures) fills one 64-byte cache line.
+template <size_t kCapacity = 1024, size_t kInlineSize = 48>
+class TaskQueue {
+  static_assert((kCapacity & (kCapacity - 1)) == 0, "");
+  static constexpr uint64_t kMask = kCapacity - 1;
+  // Blocking calls yield this many times before parking. While a thread is
+  // parked, every operation on the other side makes a futex call to wake it.
+  static constexpr int kYieldsBeforePark = 16;
+
+  struct alignas(hardware_constructive_interference_size) Slot {
+    std::atomic<uint64_t> seq;
+    InlineTask<kInlineSize> task;
+  };
+  static_assert(kInlineSize != 48
+                    || sizeof(Slot) == hardware_constructive_interference_size,
+                "");
+
+ public:
+  using Task = InlineTask<kInlineSize>;
+
+  TaskQueue() : slots_(new Slot[kCapacity]) {
+    for (uint64_t i = 0; i < kCapacity; i++) {
+      slots_[i].seq.store(i, std::memory_order::relaxed);
+    }
+  }
+
+  TaskQueue(const TaskQueue&) = delete;
+  TaskQueue& operator=(const TaskQueue&) = delete;
+
+  // Tasks still in the queue are destroyed without running.
+  ~TaskQueue() = default;
+
+  // Returns false if the queue is full.
+  template <typename F>
+  bool try_push(F&& f) {
+    uint64_t pos = enqueue_pos_.load(std::memory_order::relaxed);
+    Slot* slot;
+    while (true) {
+      slot = &slots_[pos & kMask];
+      uint64_t seq = slot->seq.load(std::memory_order::acquire);
+      int64_t diff = static_cast<int64_t>(seq - pos);
+      if (diff == 0) {
+        // seq_cst pairs with the consumer's re-check after prepare_wait().
+        if (enqueue_pos_.compare_exchange_weak(pos,
+                                               pos + 1,
+                                               std::memory_order::seq_cst,
+                                               std::memory_order::relaxed)) {
+          break;
+        }
+      } else if (diff < 0) {
+        return false;
+      } else {
+        pos = enqueue_pos_.load(std::memory_order::relaxed);
+      }
+    }
+
+    if constexpr (std::is_same_v<std::decay_t<F>, Task>) {
+      slot->task = std::forward<F>(f);
+    } else {
+      slot->task.emplace(std::forward<F>(f));
+    }
+    slot->seq.store(pos + 1, std::memory_order::release);
+    ready_event_.notify();
+    return true;
+  }
+
+  // Blocks while the queue is full.
+  template <typename F>
+  void push(F&& f) {
+    Task task{std::forward<F>(f)};
+    for (int i = 0; !try_push(std::move(task)); i++) {
+      if (i < kYieldsBeforePark) {
+        std::this_thread::yield();
+        continue;
+      }
+      uint32_t epoch = space_event_.prepare_wait();
+      if (has_space()) {
+        // A consumer has claimed the slot but not moved its task out yet.
+        space_event_.cancel_wait();
+        std::this_thread::yield();
+      } else {
+        space_event_.wait(epoch);
+      }
+    }
+  }
+
+  // Moves the task at the front of the queue into out. Returns false if the
+  // queue is empty or its front task is still being written.
+  bool try_pop(Task& out) {
+    uint64_t pos = dequeue_pos_.load(std::memory_order::relaxed);
+    Slot* slot;
+    while (true) {
+      slot = &slots_[pos & kMask];
+      uint64_t seq = slot->seq.load(std::memory_order::acquire);
+      int64_t diff = static_cast<int64_t>(seq - (pos + 1));
+      if (diff == 0) {
+        if (dequeue_pos_.compare_exchange_weak(pos,
+                                               pos + 1,
+                                               std::memory_order::seq_cst,
+                                               std::memory_order::relaxed)) {
+          break;
+        }
+      } else if (diff < 0) {
+        return false;
+      } else {
+        pos = dequeue_pos_.load(std::memory_order::relaxed);
+      }
+    }
+
+    out = std::move(slot->task);
+    slot->seq.store(pos + kCapacity, std::memory_order::release);
+    space_event_.notify();
+    return true;
+  }
+
+  // Blocks until a task is available.
+  Task pop() {
+    Task task;
+    for (int i = 0; !try_pop(task); i++) {
+      if (i < kYieldsBeforePark) {
+        std::this_thread::yield();
+        continue;
+      }
+      uint32_t epoch = ready_event_.prepare_wait();
+      if (has_tasks()) {
+        // A producer has claimed the slot but not written its task yet.
+        ready_event_.cancel_wait();
+        std::this_thread::yield();
+      } else {
+        ready_event_.wait(epoch);
+      }
+    }
+    return task;
+  }
+
+  // Pops and runs one task. Returns false if there was none.
+  bool try_run_one() {
+    Task task;
+    if (!try_pop(task)) {
+      return false;
+    }
+    task();
+    return true;
+  }
+
+  size_t size() const {
+    uint64_t head = dequeue_pos_.load(std::memory_order::acquire);
+    uint64_t tail = enqueue_pos_.load(std::memory_order::acquire);
+    return tail > head ? tail - head : 0;
+  }
+
+  static constexpr size_t capacity() { return kCapacity; }
+
+  // Signaled after pushes while a consumer waits for a task.
+  QueueEvent& ready_event() { return ready_event_; }
+
+ private:
+  std::unique_ptr<Slot[]> slots_;
+  alignas(hardware_destructive_interference_size)
+      std::atomic<uint64_t> enqueue_pos_{0};
+  alignas(hardware_destructive_interference_size)
+      std::atomic<uint64_t> dequeue_pos_{0};
+  QueueEvent ready_event_;
+  QueueEvent space_event_;
+
+  // These follow prepare_wait(), whose seq_cst update orders them against
+  // the seq_cst position updates in try_push() and try_pop().
+  bool has_tasks() const {
+    return enqueue_pos_.load(std::memory_order::seq_cst)
+         > dequeue_pos_.load(std::memory_order::seq_cst);
+  }
+
+  bool has_space() const {
+    return enqueue_pos_.load(std::memory_order::seq_cst)
+         < dequeue_pos_.load(std::memory_order::seq_cst) + kCapacity;
+  }
+};
+
+}  // namespace theta
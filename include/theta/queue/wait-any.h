@@ -0,0 +1,110 @@
+#pragma once
+
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <array>
+#include <cerrno>
+#include <concepts>
+#include <cstdint>
+
+#include "theta/queue/queue-event.h"
+
+#ifndef SYS_futex_waitv
+#define SYS_futex_waitv 449
+#endif
+
+// Kernel headers older than 5.16 lack futex_waitv's types and constants. The
+// syscall is then probed at runtime like any other.
+#ifndef FUTEX_WAITV_MAX
+#define FUTEX_32 2
+#define FUTEX_WAITV_MAX 128
+struct futex_waitv {
+  uint64_t val;
+  uint64_t uaddr;
+  uint32_t flags;
+  uint32_t __reserved;
+};
+#endif
+
+namespace theta {
+
+// A queue that can be passed to wait_any().
+template <typename Q>
+concept WaitableQueue = requires(Q& q) {
+  { q.ready_event() } -> std::same_as<QueueEvent&>;
+  { q.poll_ready() } -> std::same_as<bool>;
+};
+
+namespace internal {
+
+inline bool futex_waitv_supported() {
+  static const bool supported = []() {
+    // With no waiters, a kernel that implements futex_waitv rejects the
+    // arguments instead of the syscall.
+    return syscall(SYS_futex_waitv, nullptr, 0, 0, nullptr, 0) == 0
+        || errno != ENOSYS;
+  }();
+  return supported;
+}
+
+}  // namespace internal
+
+// Blocks until at least one of the queues is non-empty and returns the index
+// of the first such queue. Other consumers may still empty that queue before
+// the caller pops from it, so callers should treat the result as a hint and
+// loop on try_pop().
+//
+// Waiting uses futex_waitv(2) on the queues' events. On kernels older than
+// 5.16, it falls back to QueueEvent::shared(), which every queue signals while
+// it has waiters.
+template <WaitableQueue... Queues>
+size_t wait_any(Queues&... queues) {
+  static constexpr size_t kNumQueues = sizeof...(Queues);
+  static_assert(kNumQueues > 0 && kNumQueues <= FUTEX_WAITV_MAX, "");
+
+  std::array<QueueEvent*, kNumQueues> events{&queues.ready_event()...};
+  const bool use_waitv = internal::futex_waitv_supported();
+  QueueEvent& fallback = QueueEvent::shared();
+
+  while (true) {
+    std::array<uint32_t, kNumQueues> epochs;
+    for (size_t i = 0; i < kNumQueues; i++) {
+      epochs[i] = events[i]->prepare_wait();
+    }
+    uint32_t fallback_epoch = use_waitv ? 0 : fallback.prepare_wait();
+
+    size_t ready = 0;
+    // Evaluates every queue in order and stops at the first ready one.
+    ((queues.poll_ready() || (++ready, false)) || ...);
+
+    if (ready == kNumQueues) {
+      if (use_waitv) {
+        std::array<futex_waitv, kNumQueues> waiters;
+        for (size_t i = 0; i < kNumQueues; i++) {
+          waiters[i] = futex_waitv{
+              .val = epochs[i],
+              .uaddr = reinterpret_cast<uintptr_t>(events[i]->futex_word()),
+              .flags = FUTEX_32 | FUTEX_PRIVATE_FLAG,
+              .__reserved = 0,
+          };
+        }
+        syscall(SYS_futex_waitv, waiters.data(), kNumQueues, 0, nullptr, 0);
+      } else {
+        fallback.wait(fallback_epoch);
+      }
+    } else if (!use_waitv) {
+      fallback.cancel_wait();
+    }
+
+    for (auto* event : events) {
+      event->cancel_wait();
+    }
+    if (ready < kNumQueues) {
+      return ready;
+    }
+  }
+}
+
+}  // namespace theta
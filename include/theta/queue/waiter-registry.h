@@ -0,0 +1,282 @@
+#pragma once
+
+#include <sched.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <bit>
+#include <cstdint>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "theta/queue/defs.h"
+#include "theta/queue/queue-event.h"
+
+namespace theta {
+namespace internal {
+
+// Where a CPU sits in the machine, as reported by sysfs. CPUs with the same
+// llc id share a last-level cache. -1 means unknown.
+struct CpuLocation {
+  int llc{-1};
+  int node{-1};
+};
+
+inline int read_sysfs_int(const std::filesystem::path& path) {
+  std::ifstream in{path};
+  int value;
+  return in >> value ? value : -1;
+}
+
+inline CpuLocation read_cpu_location(int cpu) {
+  namespace fs = std::filesystem;
+  const fs::path base{"/sys/devices/system/cpu/cpu" + std::to_string(cpu)};
+  std::error_code ec;
+  CpuLocation location;
+
+  // The last-level cache is the index with the highest level.
+  int llc_level = 0;
+  for (const auto& entry : fs::directory_iterator{base / "cache", ec}) {
+    if (entry.path().filename().string().starts_with("index")) {
+      int level = read_sysfs_int(entry.path() / "level");
+      if (level > llc_level) {
+        llc_level = level;
+        location.llc = read_sysfs_int(entry.path() / "id");
+      }
+    }
+  }
+
+  for (const auto& entry : fs::directory_iterator{base, ec}) {
+    std::string name = entry.path().filename().string();
+    if (name.starts_with("node")) {
+      location.node = std::atoi(name.c_str() + 4);
+      break;
+    }
+  }
+
+  // Without cache ids, assume the package shares one last-level cache.
+  if (location.llc < 0) {
+    location.llc = read_sysfs_int(base / "topology" / "physical_package_id");
+  }
+  return location;
+}
+
+inline CpuLocation current_cpu_location() {
+  static const std::vector<CpuLocation> locations = []() {
+    long num_cpus = sysconf(_SC_NPROCESSORS_CONF);
+    std::vector<CpuLocation> out;
+    for (int cpu = 0; cpu < num_cpus; cpu++) {
+      out.push_back(read_cpu_location(cpu));
+    }
+    return out;
+  }();
+
+  int cpu = sched_getcpu();
+  if (cpu < 0 || static_cast<size_t>(cpu) >= locations.size()) {
+    return {};
+  }
+  return locations[cpu];
+}
+
+}  // namespace internal
+
+// An eventcount like QueueEvent, except that each parked thread waits on its
+// own futex word and records where it was running. notify() wakes the waiter
+// that is closest to the notifying thread: one that last ran on a CPU sharing
+// the notifier's last-level cache if there is one, then one on the same NUMA
+// node, then the most recently parked. The woken thread is then likely to
+// find the data that the notifier just wrote in a cache it shares.
+//
+// The protocol is the same as QueueEvent's, with a Waiter that lives on the
+// waiting thread's stack:
+//
+//   WaiterRegistry::Waiter waiter;
+//   registry.prepare_wait(waiter);
+//   if (ready()) {
+//     registry.cancel_wait(waiter);
+//   } else {
+//     registry.wait(waiter);
+//   }
+//
+// Parked threads occupy one of kMaxWaiters slots, found through a bitmap, so
+// neither side takes a lock. Threads beyond that park on a plain QueueEvent
+// and are only woken once no slot is occupied. notify() is a single load while
+// nobody is parked.
+class WaiterRegistry {
+ public:
+  static constexpr int kMaxWaiters = 64;
+
+  class Waiter {
+   public:
+    Waiter() = default;
+    Waiter(const Waiter&) = delete;
+    Waiter& operator=(const Waiter&) = delete;
+
+   private:
+    friend class WaiterRegistry;
+
+    // -1 if the waiter parks on the overflow event.
+    int slot{-1};
+    uint32_t overflow_epoch{0};
+  };
+
+  void prepare_wait(Waiter& waiter) {
+    waiter.slot = acquire_slot();
+    if (waiter.slot < 0) {
+      waiter.overflow_epoch = overflow_.prepare_wait();
+      return;
+    }
+    Slot& slot = slots_[waiter.slot];
+    slot.notified.store(0, std::memory_order::relaxed);
+    slot.location.store(internal::current_cpu_location(),
+                        std::memory_order::relaxed);
+    slot.parked_at.store(next_park_.fetch_add(1, std::memory_order::relaxed),
+                         std::memory_order::relaxed);
+    // Pairs with the load in notify(), as in QueueEvent::prepare_wait().
+    parked_.fetch_or(bit(waiter.slot), std::memory_order::seq_cst);
+  }
+
+  void cancel_wait(Waiter& waiter) {
+    if (waiter.slot < 0) {
+      overflow_.cancel_wait();
+      return;
+    }
+    uint64_t was_parked
+        = parked_.fetch_and(~bit(waiter.slot), std::memory_order::acq_rel);
+    if (was_parked & bit(waiter.slot)) {
+      release_slot(waiter.slot);
+      return;
+    }
+    // A notifier already picked this slot. Let it finish before the slot is
+    // reused, and pass the wakeup on, since it may have been meant for work
+    // that this thread will not take.
+    wait(waiter);
+    notify();
+  }
+
+  void wait(Waiter& waiter) {
+    if (waiter.slot < 0) {
+      overflow_.wait(waiter.overflow_epoch);
+      return;
+    }
+    Slot& slot = slots_[waiter.slot];
+    while (!slot.notified.load(std::memory_order::acquire)) {
+      internal::futex_wait(&slot.notified, 0);
+    }
+    release_slot(waiter.slot);
+  }
+
+  // Called after the state change has been published with a seq_cst
+  // operation. Wakes one waiter.
+  void notify() {
+    uint64_t parked = parked_.load(std::memory_order::seq_cst);
+    if (parked == 0) {
+      overflow_.notify();
+      return;
+    }
+    const internal::CpuLocation here = internal::current_cpu_location();
+    while (parked) {
+      int index = closest(parked, here);
+      parked = parked_.fetch_and(~bit(index), std::memory_order::acq_rel);
+      if (parked & bit(index)) {
+        wake(index);
+        return;
+      }
+    }
+    overflow_.notify();
+  }
+
+  void notify_all() {
+    uint64_t parked = parked_.exchange(0, std::memory_order::seq_cst);
+    while (parked) {
+      wake(std::countr_zero(parked));
+      parked &= parked - 1;
+    }
+    overflow_.notify_all();
+  }
+
+  // Excludes threads parked on the overflow event.
+  size_t num_waiters() const {
+    return std::popcount(parked_.load(std::memory_order::relaxed));
+  }
+
+ private:
+  struct alignas(hardware_destructive_interference_size) Slot {
+    std::atomic<uint32_t> notified{0};
+    // Atomic only because a notifier that lost the race for the slot may
+    // still be reading them when the next owner writes them.
+    std::atomic<internal::CpuLocation> location;
+    std::atomic<uint64_t> parked_at{0};
+  };
+
+  alignas(hardware_destructive_interference_size)
+      std::atomic<uint64_t> parked_{0};
+  // Slots that belong to a thread between prepare_wait() and the end of
+  // wait() or cancel_wait(), whether or not they are still parked.
+  alignas(hardware_destructive_interference_size)
+      std::atomic<uint64_t> owned_{0};
+  std::atomic<uint64_t> next_park_{0};
+  Slot slots_[kMaxWaiters];
+  QueueEvent overflow_;
+
+  static uint64_t bit(int index) { return uint64_t{1} << index; }
+
+  int acquire_slot() {
+    uint64_t owned = owned_.load(std::memory_order::relaxed);
+    while (~owned) {
+      int index = std::countr_one(owned);
+      if (owned_.compare_exchange_weak(owned,
+                                       owned | bit(index),
+                                       std::memory_order::acquire,
+                                       std::memory_order::relaxed)) {
+        return index;
+      }
+    }
+    return -1;
+  }
+
+  void release_slot(int index) {
+    owned_.fetch_and(~bit(index), std::memory_order::release);
+  }
+
+  // Ties go to the most recently parked waiter, whose cache is warmest. The
+  // slots in parked were fully written before their bits were set.
+  int closest(uint64_t parked, const internal::CpuLocation& here) const {
+    int best = -1;
+    int best_score = -1;
+    uint64_t best_parked_at = 0;
+    for (; parked; parked &= parked - 1) {
+      int index = std::countr_zero(parked);
+      const auto location
+          = slots_[index].location.load(std::memory_order::relaxed);
+      const uint64_t parked_at
+          = slots_[index].parked_at.load(std::memory_order::relaxed);
+      int score = 0;
+      if (here.llc >= 0 && location.llc == here.llc) {
+        score = 2;
+      } else if (here.node >= 0 && location.node == here.node) {
+        score = 1;
+      }
+      if (score > best_score
+          || (score == best_score && parked_at > best_parked_at)) {
+        best = index;
+        best_score = score;
+        best_parked_at = parked_at;
+      }
+    }
+    return best;
+  }
+
+  // Once the flag is stored, the waiter may see it and release the slot, and
+  // a new waiter may take the slot before the futex call. That waiter then
+  // gets a spurious wakeup, which is harmless since waiters loop on notified.
+  void wake(int index) {
+    slots_[index].notified.store(1, std::memory_order::release);
+    internal::futex_wake(&slots_[index].notified, 1);
+  }
+};
+
+}  // namespace theta
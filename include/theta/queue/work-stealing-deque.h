@@ -0,0 +1,109 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+#include "theta/queue/defs.h"
+
+namespace theta {
+
+// A bounded Chase-Lev deque. The owning thread pushes and pops at the bottom
+// while any thread may steal from the top. This follows the C11 formulation
+// in "Correct and Efficient Work-Stealing for Weak Memory Models" (Lê et al.,
+// 2013), with a fixed-size buffer so that no reclamation is needed; a full
+// deque rejects the push and the caller finds another home for the item.
+template <AtomType T>
+class WorkStealingDeque {
+ public:
+  explicit WorkStealingDeque(size_t capacity)
+      : buf_(next_pow_2(capacity)), mask_(buf_.size() - 1) {}
+
+  // Owner only.
+  bool push(T val) {
+    int64_t b = bottom_.load(std::memory_order::relaxed);
+    int64_t t = top_.load(std::memory_order::acquire);
+    if (b - t >= static_cast<int64_t>(buf_.size())) {
+      return false;
+    }
+    buf_[b & mask_].store(val, std::memory_order::relaxed);
+    // seq_cst rather than release so that a subsequent QueueEvent::notify()
+    // cannot miss a thief that is about to park.
+    bottom_.store(b + 1, std::memory_order::seq_cst);
+    return true;
+  }
+
+  // Owner only.
+  std::optional<T> pop() {
+    int64_t b = bottom_.load(std::memory_order::relaxed) - 1;
+    bottom_.store(b, std::memory_order::relaxed);
+    std::atomic_thread_fence(std::memory_order::seq_cst);
+    int64_t t = top_.load(std::memory_order::relaxed);
+
+    if (t > b) {
+      bottom_.store(b + 1, std::memory_order::relaxed);
+      return {};
+    }
+
+    T val = buf_[b & mask_].load(std::memory_order::relaxed);
+    if (t == b) {
+      // The last item; race the thieves for it.
+      if (!top_.compare_exchange_strong(t,
+                                        t + 1,
+                                        std::memory_order::seq_cst,
+                                        std::memory_order::relaxed)) {
+        bottom_.store(b + 1, std::memory_order::relaxed);
+        return {};
+      }
+      bottom_.store(b + 1, std::memory_order::relaxed);
+    }
+    return val;
+  }
+
+  // Any thread. Returns nothing if the deque is empty or another thread won
+  // the race for the top item.
+  std::optional<T> steal() {
+    int64_t t = top_.load(std::memory_order::acquire);
+    std::atomic_thread_fence(std::memory_order::seq_cst);
+    int64_t b = bottom_.load(std::memory_order::acquire);
+    if (t >= b) {
+      return {};
+    }
+
+    T val = buf_[t & mask_].load(std::memory_order::relaxed);
+    if (!top_.compare_exchange_strong(t,
+                                      t + 1,
+                                      std::memory_order::seq_cst,
+                                      std::memory_order::relaxed)) {
+      return {};
+    }
+    return val;
+  }
+
+  size_t size() const {
+    int64_t b = bottom_.load(std::memory_order::acquire);
+    int64_t t = top_.load(std::memory_order::acquire);
+    return b > t ? b - t : 0;
+  }
+
+  size_t capacity() const { return buf_.size(); }
+
+ private:
+  alignas(hardware_destructive_interference_size) std::atomic<int64_t> top_{0};
+  alignas(
+      hardware_destructive_interference_size) std::atomic<int64_t> bottom_{0};
+  alignas(hardware_destructive_interference_size)
+      std::vector<std::atomic<T>> buf_;
+  const size_t mask_;
+
+  static constexpr size_t next_pow_2(size_t v) {
+    size_t p = 1;
+    while (p < v) {
+      p <<= 1;
+    }
+    return p;
+  }
+};
+
+}  // namespace theta
@@ -0,0 +1,176 @@
+#pragma once
+
+#include <atomic>
+#include <coroutine>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <thread>
+#include <vector>
+
+#include "theta/queue/mpmc-queue.h"
+#include "theta/queue/waiter-registry.h"
+#include "theta/queue/work-stealing-deque.h"
+
+namespace theta {
+
+// A thread pool where each worker owns a WorkStealingDeque. Tasks submitted
+// from a worker go to the bottom of its own deque; tasks submitted from other
+// threads, and tasks that overflow a full deque, go through a shared
+// MPMCQueue. A worker never blocks on a full MPMCQueue, since every worker
+// could be doing the same; it keeps what does not fit in a private overflow
+// list instead, and moves it back into its deque as the deque empties. Idle
+// workers steal from randomly chosen victims and then park in a
+// WaiterRegistry, so that a submitted task wakes a worker that shares a cache
+// with the submitting thread when one is parked.
+//
+// Also satisfies CoroutineExecutor, so it can resume coroutines suspended on
+// the queues' awaitables.
+class WorkStealingExecutor {
+  using Task = std::function<void()>;
+  static constexpr size_t kInjectionQueueSize = 1024;
+  static constexpr size_t kLocalQueueSize = 4096;
+
+ public:
+  explicit WorkStealingExecutor(
+      size_t num_workers = std::thread::hardware_concurrency()) {
+    if (num_workers == 0) {
+      num_workers = 1;
+    }
+    for (size_t i = 0; i < num_workers; i++) {
+      workers_.push_back(std::make_unique<Worker>());
+    }
+    for (size_t i = 0; i < num_workers; i++) {
+      workers_[i]->thread = std::thread{[this, i]() { run_worker(i); }};
+    }
+  }
+
+  WorkStealingExecutor(const WorkStealingExecutor&) = delete;
+  WorkStealingExecutor& operator=(const WorkStealingExecutor&) = delete;
+
+  // Runs every task that has been submitted, then joins the workers.
+  ~WorkStealingExecutor() {
+    stopping_.store(true, std::memory_order::seq_cst);
+    parked_.notify_all();
+    for (auto& worker : workers_) {
+      worker->thread.join();
+    }
+  }
+
+  template <typename F>
+  void submit(F&& f) {
+    auto* task = new Task{std::forward<F>(f)};
+    if (current_executor_ == this) {
+      Worker& worker = *workers_[current_worker_];
+      if (!worker.deque.push(task) && !injection_.try_push(task)) {
+        worker.overflow.push_back(task);
+        return;
+      }
+      parked_.notify();
+      return;
+    }
+    injection_.push(task);
+    parked_.notify();
+  }
+
+  void schedule(std::coroutine_handle<> h) {
+    submit([h]() { h.resume(); });
+  }
+
+  size_t num_workers() const { return workers_.size(); }
+
+ private:
+  struct Worker {
+    WorkStealingDeque<Task*> deque{kLocalQueueSize};
+    // Only touched by the worker's own thread.
+    std::vector<Task*> overflow;
+    std::thread thread;
+  };
+
+  std::vector<std::unique_ptr<Worker>> workers_;
+  MPMCQueue<Task*, kInjectionQueueSize> injection_;
+  std::atomic<bool> stopping_{false};
+  WaiterRegistry parked_;
+
+  static inline thread_local WorkStealingExecutor* current_executor_{nullptr};
+  static inline thread_local size_t current_worker_{0};
+
+  void run_worker(size_t index) {
+    current_executor_ = this;
+    current_worker_ = index;
+    uint64_t rng = index * 0x9e3779b97f4a7c15ULL + 1;
+
+    while (true) {
+      Task* task = find_task(index, rng);
+      if (task) {
+        (*task)();
+        delete task;
+        continue;
+      }
+
+      WaiterRegistry::Waiter waiter;
+      parked_.prepare_wait(waiter);
+      if (has_visible_work()) {
+        parked_.cancel_wait(waiter);
+      } else if (stopping_.load(std::memory_order::seq_cst)) {
+        parked_.cancel_wait(waiter);
+        return;
+      } else {
+        parked_.wait(waiter);
+      }
+    }
+  }
+
+  Task* find_task(size_t index, uint64_t& rng) {
+    Worker& worker = *workers_[index];
+    if (auto task = worker.deque.pop()) {
+      return *task;
+    }
+    if (!worker.overflow.empty()) {
+      // Back into the deque, where thieves can reach them.
+      while (!worker.overflow.empty()
+             && worker.deque.push(worker.overflow.back())) {
+        worker.overflow.pop_back();
+      }
+      parked_.notify();
+      if (auto task = worker.deque.pop()) {
+        return *task;
+      }
+    }
+    if (auto task = injection_.try_pop()) {
+      return *task;
+    }
+
+    // xorshift64 to pick where the sweep over victims starts.
+    rng ^= rng << 13;
+    rng ^= rng >> 7;
+    rng ^= rng << 17;
+    size_t n = workers_.size();
+    size_t start = rng % n;
+    for (size_t i = 0; i < n; i++) {
+      size_t victim = (start + i) % n;
+      if (victim == index) {
+        continue;
+      }
+      if (auto task = workers_[victim]->deque.steal()) {
+        return *task;
+      }
+    }
+    return nullptr;
+  }
+
+  bool has_visible_work() {
+    if (injection_.poll_ready()) {
+      return true;
+    }
+    for (auto& worker : workers_) {
+      if (worker->deque.size() > 0) {
+        return true;
+      }
+    }
+    return false;
+  }
+};
+
+}  // namespace theta
@@ -0,0 +1,114 @@
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <latch>
+#include <memory>
+#include <optional>
+#include <vector>
+
+#include "theta/queue/actor.h"
+
+namespace theta {
+
+class Counter : public Actor<uint64_t> {
+ public:
+  Counter(ActorScheduler& scheduler, std::latch& done)
+      : Actor(scheduler), done_(done) {}
+
+  uint64_t sum() const { return sum_; }
+  uint64_t max_concurrency() const { return max_concurrency_; }
+
+ protected:
+  void receive(uint64_t msg) override {
+    uint64_t running = ++running_;
+    if (running > max_concurrency_) {
+      max_concurrency_ = running;
+    }
+    sum_ += msg;
+    --running_;
+    done_.count_down();
+  }
+
+ private:
+  std::latch& done_;
+  uint64_t sum_{0};
+  std::atomic<uint64_t> running_{0};
+  std::atomic<uint64_t> max_concurrency_{0};
+};
+
+TEST(ActorTests, fan_in_from_many_threads) {
+  static constexpr uint64_t kMessagesPerThread = 20000;
+  static constexpr int kNumThreads = 4;
+  std::latch done{kNumThreads * kMessagesPerThread};
+  std::optional<DefaultActorScheduler> scheduler;
+  scheduler.emplace(4, /*messages_per_activation=*/8);
+  Counter counter{*scheduler, done};
+
+  std::vector<std::thread> senders;
+  for (int i = 0; i < kNumThreads; i++) {
+    senders.emplace_back([&]() {
+      for (uint64_t i = 1; i <= kMessagesPerThread; i++) {
+        while (!counter.send(i)) {
+          std::this_thread::yield();
+        }
+      }
+    });
+  }
+  for (auto& s : senders) {
+    s.join();
+  }
+  done.wait();
+  scheduler.reset();
+
+  EXPECT_EQ(counter.sum(),
+            kNumThreads * kMessagesPerThread * (kMessagesPerThread + 1) / 2);
+  EXPECT_EQ(counter.max_concurrency(), 1);
+}
+
+class Relay : public Actor<uint64_t> {
+ public:
+  Relay(ActorScheduler& scheduler, std::latch& done)
+      : Actor(scheduler), done_(done) {}
+
+  void set_next(Relay* next) { next_ = next; }
+
+ protected:
+  void receive(uint64_t hops_left) override {
+    if (hops_left == 1) {
+      done_.count_down();
+      return;
+    }
+    while (!next_->send(hops_left - 1)) {
+      std::this_thread::yield();
+    }
+  }
+
+ private:
+  std::latch& done_;
+  Relay* next_{nullptr};
+};
+
+TEST(ActorTests, ring_of_actors) {
+  static constexpr int kNumActors = 1000;
+  static constexpr int kNumTokens = 16;
+  static constexpr uint64_t kHops = 10 * kNumActors;
+  std::latch done{kNumTokens};
+  std::optional<DefaultActorScheduler> scheduler;
+  scheduler.emplace(4);
+
+  std::vector<std::unique_ptr<Relay>> ring;
+  for (int i = 0; i < kNumActors; i++) {
+    ring.push_back(std::make_unique<Relay>(*scheduler, done));
+  }
+  for (int i = 0; i < kNumActors; i++) {
+    ring[i]->set_next(ring[(i + 1) % kNumActors].get());
+  }
+
+  for (int i = 0; i < kNumTokens; i++) {
+    ring[i * (kNumActors / kNumTokens)]->send(kHops);
+  }
+  done.wait();
+  scheduler.reset();
+}
+
+}  // namespace theta
@@ -0,0 +1,128 @@
+#include <gtest/gtest.h>
+#include <sys/mman.h>
+
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "theta/queue/async-logger.h"
+#include "theta/queue/byte-ring.h"
+
+namespace theta {
+
+TEST(MPSCByteRingTests, records_round_trip_across_wraps) {
+  MPSCByteRing ring{256};
+  std::vector<std::string> seen;
+  auto collect = [&](std::span<const std::byte> record) {
+    seen.emplace_back(reinterpret_cast<const char*>(record.data()),
+                      record.size());
+  };
+
+  for (int i = 0; i < 100; i++) {
+    std::string msg = "record-" + std::to_string(i) + std::string(i % 13, 'x');
+    auto r = ring.reserve(msg.size());
+    ASSERT_TRUE(r);
+    memcpy(r.payload().data(), msg.data(), msg.size());
+    ring.commit(r);
+
+    ring.consume(collect);
+    ASSERT_EQ(seen.size(), i + 1);
+    EXPECT_EQ(seen.back(), msg);
+  }
+  EXPECT_TRUE(ring.empty());
+}
+
+TEST(MPSCByteRingTests, uncommitted_record_blocks_later_ones) {
+  MPSCByteRing ring{256};
+  auto first = ring.reserve(8);
+  auto second = ring.reserve(8);
+  ASSERT_TRUE(first);
+  ASSERT_TRUE(second);
+  ring.commit(second);
+
+  size_t n = 0;
+  EXPECT_EQ(ring.consume([&](auto) { n++; }), 0);
+  ring.commit(first);
+  EXPECT_EQ(ring.consume([&](auto) { n++; }), 2);
+  EXPECT_EQ(n, 2);
+}
+
+TEST(MPSCByteRingTests, rejects_when_full) {
+  MPSCByteRing ring{256};
+  EXPECT_FALSE(ring.reserve(MPSCByteRing::max_record_size(256) + 1));
+
+  int reserved = 0;
+  while (auto r = ring.reserve(24)) {
+    ring.commit(r);
+    reserved++;
+  }
+  EXPECT_EQ(reserved, 256 / 32);
+}
+
+static std::string read_all(int fd) {
+  std::string contents;
+  char buf[4096];
+  ssize_t n;
+  off_t offset = 0;
+  while ((n = pread(fd, buf, sizeof(buf), offset)) > 0) {
+    contents.append(buf, n);
+    offset += n;
+  }
+  return contents;
+}
+
+TEST(AsyncLoggerTests, formats_arguments) {
+  int fd = memfd_create("async-logger-test", 0);
+  ASSERT_GE(fd, 0);
+  {
+    AsyncLogger logger{fd};
+    std::string name = "world";
+    EXPECT_TRUE(logger.log("hello {}", name));
+    EXPECT_TRUE(logger.log("{} + {} = {:.1f}", 1, 2u, 3.0));
+    EXPECT_TRUE(logger.log("{}|{}|{}", "literal", std::string_view{"sv"}, 'c'));
+    logger.flush();
+    EXPECT_EQ(read_all(fd), "hello world\n1 + 2 = 3.0\nliteral|sv|c\n");
+  }
+  close(fd);
+}
+
+TEST(AsyncLoggerTests, concurrent_producers_keep_per_thread_order) {
+  static constexpr int kNumThreads = 4;
+  static constexpr int kLinesPerThread = 5000;
+  int fd = memfd_create("async-logger-test", 0);
+  ASSERT_GE(fd, 0);
+  {
+    AsyncLogger logger{fd, /*buffer_size=*/1 << 12};
+    std::vector<std::thread> threads;
+    for (int t = 0; t < kNumThreads; t++) {
+      threads.emplace_back([&, t]() {
+        for (int i = 0; i < kLinesPerThread; i++) {
+          while (!logger.log("{} {}", t, i)) {
+            std::this_thread::yield();
+          }
+        }
+      });
+    }
+    for (auto& t : threads) {
+      t.join();
+    }
+  }
+
+  std::vector<int> next(kNumThreads, 0);
+  std::string contents = read_all(fd);
+  size_t begin = 0;
+  int lines = 0;
+  while (begin < contents.size()) {
+    size_t end = contents.find('\n', begin);
+    ASSERT_NE(end, std::string::npos);
+    int t, i;
+    ASSERT_EQ(sscanf(contents.c_str() + begin, "%d %d", &t, &i), 2);
+    EXPECT_EQ(i, next[t]++);
+    begin = end + 1;
+    lines++;
+  }
+  EXPECT_EQ(lines, kNumThreads * kLinesPerThread);
+  close(fd);
+}
+
+}  // namespace theta
@@ -0,0 +1,87 @@
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+#include "theta/queue/coalescing-queue.h"
+
+namespace theta {
+
+TEST(CoalescingQueueTests, duplicates_are_dropped_while_pending) {
+  CoalescingQueue<100> queue;
+  EXPECT_TRUE(queue.push(3));
+  EXPECT_FALSE(queue.push(3));
+  EXPECT_TRUE(queue.push(99));
+  EXPECT_TRUE(queue.push(64));
+  EXPECT_FALSE(queue.push(99));
+  EXPECT_EQ(queue.size(), 3);
+  EXPECT_TRUE(queue.is_pending(3));
+
+  EXPECT_EQ(queue.try_pop(), 3);
+  EXPECT_FALSE(queue.is_pending(3));
+  // Pending again once it has been popped.
+  EXPECT_TRUE(queue.push(3));
+
+  EXPECT_EQ(queue.pop(), 99);
+  EXPECT_EQ(queue.pop(), 64);
+  EXPECT_EQ(queue.pop(), 3);
+  EXPECT_FALSE(queue.try_pop().has_value());
+}
+
+// Producers bump a per-key version and signal the key. Once they stop, the
+// consumer must have processed every key at its final version, while
+// handling far fewer entries than there were signals.
+TEST(CoalescingQueueTests, no_update_is_lost) {
+  static constexpr size_t kNumKeys = 256;
+  static constexpr int kNumProducers = 3;
+  static constexpr uint64_t kSignalsPerProducer = 100000;
+  CoalescingQueue<kNumKeys> queue;
+  std::vector<std::atomic<uint64_t>> version(kNumKeys);
+  std::vector<uint64_t> seen(kNumKeys, 0);
+  std::atomic<bool> done{false};
+
+  std::vector<std::thread> producers;
+  for (int p = 0; p < kNumProducers; p++) {
+    producers.emplace_back([&, p]() {
+      for (uint64_t i = 0; i < kSignalsPerProducer; i++) {
+        uint32_t key = (i * 7 + p) % kNumKeys;
+        version[key].fetch_add(1, std::memory_order::relaxed);
+        queue.push(key);
+      }
+    });
+  }
+
+  uint64_t processed = 0;
+  std::thread consumer{[&]() {
+    while (true) {
+      auto key = queue.try_pop();
+      if (!key) {
+        if (done.load(std::memory_order::acquire)) {
+          return;
+        }
+        std::this_thread::yield();
+        continue;
+      }
+      seen[*key] = version[*key].load(std::memory_order::relaxed);
+      processed++;
+    }
+  }};
+
+  for (auto& t : producers) {
+    t.join();
+  }
+  done.store(true, std::memory_order::release);
+  consumer.join();
+
+  uint64_t total = 0;
+  for (size_t key = 0; key < kNumKeys; key++) {
+    EXPECT_EQ(seen[key], version[key].load());
+    total += seen[key];
+  }
+  EXPECT_EQ(total, kNumProducers * kSignalsPerProducer);
+  EXPECT_LE(processed, total);
+}
+
+}  // namespace theta
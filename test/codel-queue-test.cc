@@ -0,0 +1,67 @@
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+#include "theta/queue/codel-queue.h"
+
+namespace theta {
+
+using namespace std::chrono_literals;
+
+TEST(CoDelQueueTests, short_bursts_are_not_dropped) {
+  CoDelQueue<64> queue{QueueOpts{}.set_codel(1ms, 10ms)};
+  for (int round = 0; round < 5; round++) {
+    for (uint32_t i = 0; i < 32; i++) {
+      EXPECT_TRUE(queue.try_push(i));
+    }
+    std::this_thread::sleep_for(2ms);
+    for (uint32_t i = 0; i < 32; i++) {
+      EXPECT_EQ(queue.try_pop(), i);
+    }
+  }
+  EXPECT_EQ(queue.num_dropped(), 0);
+}
+
+// Items stay above the target for longer than an interval, so the consumer
+// starts dropping, rejects pushes while it does, and stops once the queue
+// drains.
+TEST(CoDelQueueTests, standing_queue_is_dropped) {
+  CoDelQueue<128> queue{QueueOpts{}.set_codel(1ms, 10ms, /*reject=*/true)};
+  for (uint32_t i = 1; i <= 64; i++) {
+    EXPECT_TRUE(queue.try_push(i));
+  }
+  std::vector<uint32_t> dropped;
+  auto on_drop = [&](uint32_t item) { dropped.push_back(item); };
+
+  std::this_thread::sleep_for(2ms);
+  EXPECT_EQ(queue.try_pop(on_drop), 1);
+  EXPECT_FALSE(queue.dropping());
+
+  std::this_thread::sleep_for(11ms);
+  EXPECT_EQ(queue.try_pop(on_drop), 3);
+  EXPECT_EQ(dropped, (std::vector<uint32_t>{2}));
+  EXPECT_TRUE(queue.dropping());
+  EXPECT_FALSE(queue.try_push(100));
+  EXPECT_EQ(queue.num_rejected(), 1);
+
+  // The next drop is due an interval later, and later ones come faster.
+  std::this_thread::sleep_for(11ms);
+  auto item = queue.try_pop(on_drop);
+  ASSERT_GE(dropped.size(), 2);
+  EXPECT_EQ(dropped[1], 4);
+  EXPECT_EQ(item, dropped.back() + 1);
+
+  size_t delivered = 3;
+  while (queue.try_pop(on_drop)) {
+    delivered++;
+  }
+  EXPECT_EQ(delivered + dropped.size(), 64);
+  EXPECT_EQ(queue.num_dropped(), dropped.size());
+  EXPECT_FALSE(queue.dropping());
+  EXPECT_TRUE(queue.try_push(100));
+}
+
+}  // namespace theta
@@ -0,0 +1,134 @@
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+#include "theta/queue/core-mesh.h"
+#include "theta/queue/spsc-ring.h"
+
+namespace theta {
+
+TEST(SPSCRingTests, batches_wrap_around) {
+  SPSCRing<uint64_t, 8> ring;
+  uint64_t next_in = 0;
+  uint64_t next_out = 0;
+
+  for (int round = 0; round < 10; round++) {
+    uint64_t items[6];
+    for (auto& item : items) {
+      item = next_in++;
+    }
+    EXPECT_EQ(ring.try_push_n(items, 6), 6);
+    EXPECT_EQ(ring.size(), 6);
+    EXPECT_EQ(ring.consume([&](uint64_t v) { EXPECT_EQ(v, next_out++); }, 4),
+              4);
+    EXPECT_EQ(ring.consume([&](uint64_t v) { EXPECT_EQ(v, next_out++); }), 2);
+    EXPECT_TRUE(ring.empty());
+  }
+
+  uint64_t items[10] = {};
+  EXPECT_EQ(ring.try_push_n(items, 10), 8);
+  EXPECT_FALSE(ring.try_push(0));
+}
+
+TEST(SPSCRingTests, concurrent_producer_and_consumer) {
+  static constexpr uint64_t kNumItems = 200000;
+  SPSCRing<uint64_t, 64> ring;
+
+  std::thread producer{[&]() {
+    for (uint64_t i = 1; i <= kNumItems;) {
+      if (ring.try_push(i)) {
+        i++;
+      } else {
+        std::this_thread::yield();
+      }
+    }
+  }};
+
+  uint64_t expected = 1;
+  while (expected <= kNumItems) {
+    if (ring.consume([&](uint64_t v) { EXPECT_EQ(v, expected++); }) == 0) {
+      std::this_thread::yield();
+    }
+  }
+  producer.join();
+}
+
+// Every core sends kMessagesPerPair messages to every core, itself included,
+// and checks that each sender's messages arrive complete and in order.
+TEST(CoreMeshTests, all_to_all) {
+  static constexpr size_t kNumCores = 4;
+  static constexpr uint64_t kMessagesPerPair = 5000;
+  CoreMesh<uint64_t, /*kRingCapacity=*/64, /*kBatchSize=*/8> mesh{kNumCores};
+
+  std::vector<std::thread> cores;
+  for (size_t core = 0; core < kNumCores; core++) {
+    cores.emplace_back([&, core]() {
+      std::vector<uint64_t> next_seq(kNumCores, 0);
+      uint64_t received = 0;
+      auto on_message = [&](size_t src, uint64_t msg) {
+        EXPECT_EQ(msg >> 32, src);
+        EXPECT_EQ(msg & 0xffffffff, next_seq[src]++);
+        received++;
+      };
+
+      for (uint64_t seq = 0; seq < kMessagesPerPair; seq++) {
+        for (size_t dst = 0; dst < kNumCores; dst++) {
+          while (!mesh.send(core, dst, (uint64_t{core} << 32) | seq)) {
+            if (mesh.poll(core, on_message) == 0) {
+              std::this_thread::yield();
+            }
+          }
+        }
+        mesh.poll(core, on_message, /*budget=*/16);
+      }
+      while (received < kNumCores * kMessagesPerPair) {
+        if (mesh.poll(core, on_message) == 0) {
+          std::this_thread::yield();
+        }
+      }
+    });
+  }
+  for (auto& t : cores) {
+    t.join();
+  }
+}
+
+// More cores than fit in one word of the ready bitmap.
+TEST(CoreMeshTests, many_cores) {
+  static constexpr size_t kNumCores = 130;
+  CoreMesh<uint64_t, /*kRingCapacity=*/4, /*kBatchSize=*/2> mesh{kNumCores};
+
+  for (size_t src : {0, 63, 64, 129}) {
+    EXPECT_TRUE(mesh.send(src, 100, src));
+    mesh.flush(src);
+  }
+  std::vector<size_t> senders;
+  EXPECT_EQ(mesh.poll(100,
+                      [&](size_t src, uint64_t msg) {
+                        EXPECT_EQ(src, msg);
+                        senders.push_back(src);
+                      }),
+            4);
+  EXPECT_EQ(senders, (std::vector<size_t>{0, 63, 64, 129}));
+  EXPECT_EQ(mesh.poll(100, [](size_t, uint64_t) {}), 0);
+}
+
+// A message left behind by an exhausted budget is picked up by the next poll.
+TEST(CoreMeshTests, budget_keeps_sender_ready) {
+  CoreMesh<uint64_t, /*kRingCapacity=*/16, /*kBatchSize=*/4> mesh{2};
+  for (uint64_t i = 0; i < 3; i++) {
+    EXPECT_TRUE(mesh.send(0, 1, i));
+  }
+  mesh.flush(0);
+
+  uint64_t next = 0;
+  auto on_message = [&](size_t, uint64_t msg) { EXPECT_EQ(msg, next++); };
+  EXPECT_EQ(mesh.poll(1, on_message, /*budget=*/2), 2);
+  EXPECT_EQ(mesh.poll(1, on_message), 1);
+  EXPECT_EQ(next, 3);
+}
+
+}  // namespace theta
@@ -0,0 +1,145 @@
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <latch>
+#include <thread>
+#include <vector>
+
+#include "theta/queue/epoch.h"
+#include "theta/queue/mpmc-queue.h"
+
+namespace theta {
+
+struct Tracked {
+  static inline std::atomic<int> live{0};
+  static constexpr uint64_t kCanary = 0x5ca1ab1e;
+
+  uint64_t canary{kCanary};
+  uint64_t value;
+
+  explicit Tracked(uint64_t value) : value(value) { live++; }
+  ~Tracked() {
+    canary = 0;
+    live--;
+  }
+};
+
+// Collects until everything retired by this thread has been freed.
+static void collect_all(EpochDomain& domain) {
+  for (int i = 0; i < 3; i++) {
+    domain.collect();
+  }
+}
+
+TEST(EpochDomainTests, guard_defers_reclamation) {
+  EpochDomain domain;
+  std::latch pinned{1};
+  std::latch release{1};
+  std::thread reader{[&]() {
+    auto guard = domain.pin();
+    pinned.count_down();
+    release.wait();
+  }};
+  pinned.wait();
+
+  domain.retire(new Tracked{1});
+  collect_all(domain);
+  EXPECT_EQ(Tracked::live, 1);
+
+  release.count_down();
+  reader.join();
+  collect_all(domain);
+  EXPECT_EQ(Tracked::live, 0);
+}
+
+TEST(EpochDomainTests, nested_guards) {
+  EpochDomain domain;
+  {
+    auto outer = domain.pin();
+    {
+      auto inner = domain.pin();
+    }
+    // The outer guard still pins this thread, so the epoch can advance at
+    // most once past it.
+    domain.retire(new Tracked{1});
+    collect_all(domain);
+    EXPECT_EQ(Tracked::live, 1);
+  }
+  collect_all(domain);
+  EXPECT_EQ(Tracked::live, 0);
+}
+
+TEST(EpochDomainTests, destructor_frees_retired) {
+  {
+    EpochDomain domain;
+    auto guard = domain.pin();
+    domain.retire(new Tracked{1});
+  }
+  EXPECT_EQ(Tracked::live, 0);
+}
+
+// Consumers retire what they pop while other threads peek at the front of the
+// queue and read the item under a guard.
+TEST(EpochDomainTests, peek_while_consumers_retire) {
+  static constexpr uint64_t kNumItems = 100000;
+  EpochDomain domain;
+  MPMCQueue<Tracked*> queue;
+  std::atomic<bool> done{false};
+  std::atomic<uint64_t> sum{0};
+
+  std::thread producer{[&]() {
+    for (uint64_t i = 1; i <= kNumItems; i++) {
+      queue.push(new Tracked{i});
+    }
+  }};
+
+  std::vector<std::thread> consumers;
+  for (int c = 0; c < 2; c++) {
+    consumers.emplace_back([&]() {
+      while (true) {
+        auto item = queue.try_pop();
+        if (!item) {
+          if (done.load()) {
+            break;
+          }
+          continue;
+        }
+        sum += (*item)->value;
+        domain.retire(*item);
+      }
+      collect_all(domain);
+    });
+  }
+
+  std::vector<std::thread> inspectors;
+  std::atomic<uint64_t> bad_reads{0};
+  for (int r = 0; r < 2; r++) {
+    inspectors.emplace_back([&]() {
+      while (!done.load()) {
+        auto guard = domain.pin();
+        if (auto item = queue.peek()) {
+          if ((*item)->canary != Tracked::kCanary) {
+            bad_reads++;
+          }
+        }
+      }
+    });
+  }
+
+  producer.join();
+  while (queue.size() > 0) {
+    std::this_thread::yield();
+  }
+  done.store(true);
+  for (auto& t : consumers) {
+    t.join();
+  }
+  for (auto& t : inspectors) {
+    t.join();
+  }
+
+  EXPECT_EQ(bad_reads, 0);
+  EXPECT_EQ(sum, kNumItems * (kNumItems + 1) / 2);
+}
+
+}  // namespace theta
@@ -0,0 +1,225 @@
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <coroutine>
+#include <latch>
+#include <thread>
+#include <vector>
+
+#include "theta/queue/waiter-registry.h"
+#include "theta/queue/work-stealing-deque.h"
+#include "theta/queue/work-stealing-executor.h"
+
+namespace theta {
+
+TEST(WorkStealingDequeTests, owner_pops_lifo_thieves_steal_fifo) {
+  WorkStealingDeque<uint64_t> deque{4};
+  EXPECT_EQ(deque.capacity(), 4);
+
+  for (uint64_t i = 1; i <= 4; i++) {
+    EXPECT_TRUE(deque.push(i));
+  }
+  EXPECT_FALSE(deque.push(5));
+
+  EXPECT_EQ(deque.steal(), 1);
+  EXPECT_EQ(deque.pop(), 4);
+  EXPECT_EQ(deque.steal(), 2);
+  EXPECT_EQ(deque.pop(), 3);
+  EXPECT_FALSE(deque.pop().has_value());
+  EXPECT_FALSE(deque.steal().has_value());
+}
+
+TEST(WorkStealingDequeTests, concurrent_steals_take_each_item_once) {
+  static constexpr uint64_t kNumItems = 100000;
+  static constexpr int kNumThieves = 3;
+  WorkStealingDeque<uint64_t> deque{256};
+  std::atomic<uint64_t> sum{0};
+  std::atomic<uint64_t> taken{0};
+
+  std::vector<std::thread> thieves;
+  for (int i = 0; i < kNumThieves; i++) {
+    thieves.emplace_back([&]() {
+      while (taken.load() < kNumItems) {
+        if (auto v = deque.steal()) {
+          sum += *v;
+          taken++;
+        }
+      }
+    });
+  }
+
+  for (uint64_t i = 1; i <= kNumItems; i++) {
+    while (!deque.push(i)) {
+      if (auto v = deque.pop()) {
+        sum += *v;
+        taken++;
+      }
+    }
+  }
+  while (auto v = deque.pop()) {
+    sum += *v;
+    taken++;
+  }
+  for (auto& t : thieves) {
+    t.join();
+  }
+
+  EXPECT_EQ(taken.load(), kNumItems);
+  EXPECT_EQ(sum.load(), kNumItems * (kNumItems + 1) / 2);
+}
+
+static void park_until(WaiterRegistry& registry, std::atomic<bool>& ready) {
+  while (!ready.load(std::memory_order::seq_cst)) {
+    WaiterRegistry::Waiter waiter;
+    registry.prepare_wait(waiter);
+    if (ready.load(std::memory_order::seq_cst)) {
+      registry.cancel_wait(waiter);
+    } else {
+      registry.wait(waiter);
+    }
+  }
+}
+
+TEST(WaiterRegistryTests, notify_all_wakes_every_waiter) {
+  static constexpr int kNumThreads = 4;
+  WaiterRegistry registry;
+  std::atomic<bool> ready{false};
+
+  std::vector<std::thread> threads;
+  for (int i = 0; i < kNumThreads; i++) {
+    threads.emplace_back([&]() { park_until(registry, ready); });
+  }
+  while (registry.num_waiters() < kNumThreads) {
+    std::this_thread::yield();
+  }
+  ready.store(true, std::memory_order::seq_cst);
+  registry.notify_all();
+  for (auto& t : threads) {
+    t.join();
+  }
+  EXPECT_EQ(registry.num_waiters(), 0);
+}
+
+// notify() picks the closest waiter, and this thread is as close to itself as
+// any other waiter can be and parked last, so it takes the wakeup. Cancelling
+// must then pass the wakeup on to the parked thread.
+TEST(WaiterRegistryTests, cancel_wait_passes_on_wakeup) {
+  WaiterRegistry registry;
+  std::atomic<bool> ready{false};
+  std::thread parked{[&]() { park_until(registry, ready); }};
+  while (registry.num_waiters() < 1) {
+    std::this_thread::yield();
+  }
+
+  WaiterRegistry::Waiter waiter;
+  registry.prepare_wait(waiter);
+  ready.store(true, std::memory_order::seq_cst);
+  registry.notify();
+  EXPECT_EQ(registry.num_waiters(), 1);
+  registry.cancel_wait(waiter);
+  parked.join();
+  EXPECT_EQ(registry.num_waiters(), 0);
+}
+
+TEST(WorkStealingExecutorTests, runs_external_submissions) {
+  static constexpr int kNumTasks = 10000;
+  std::atomic<int> count{0};
+  std::latch done{kNumTasks};
+  WorkStealingExecutor executor{4};
+
+  for (int i = 0; i < kNumTasks; i++) {
+    executor.submit([&]() {
+      count++;
+      done.count_down();
+    });
+  }
+  done.wait();
+  EXPECT_EQ(count.load(), kNumTasks);
+}
+
+static void spawn_tree(WorkStealingExecutor& executor,
+                       int depth,
+                       std::atomic<int>& leaves,
+                       std::latch& done) {
+  if (depth == 0) {
+    leaves++;
+    done.count_down();
+    return;
+  }
+  for (int i = 0; i < 2; i++) {
+    executor.submit(
+        [&, depth]() { spawn_tree(executor, depth - 1, leaves, done); });
+  }
+}
+
+TEST(WorkStealingExecutorTests, fork_join_from_workers) {
+  static constexpr int kDepth = 14;
+  std::atomic<int> leaves{0};
+  std::latch done{1 << kDepth};
+  WorkStealingExecutor executor{4};
+
+  executor.submit([&]() { spawn_tree(executor, kDepth, leaves, done); });
+  done.wait();
+  EXPECT_EQ(leaves.load(), 1 << kDepth);
+}
+
+// A single worker fans out more children than its deque and the injection
+// queue hold together, so the rest must overflow without blocking.
+TEST(WorkStealingExecutorTests, fan_out_beyond_queue_capacity) {
+  static constexpr int kNumChildren = 4096 + 1024 + 3000;
+  std::atomic<int> count{0};
+  std::latch done{kNumChildren};
+  WorkStealingExecutor executor{1};
+
+  executor.submit([&]() {
+    for (int i = 0; i < kNumChildren; i++) {
+      executor.submit([&]() {
+        count++;
+        done.count_down();
+      });
+    }
+  });
+  done.wait();
+  EXPECT_EQ(count.load(), kNumChildren);
+}
+
+TEST(WorkStealingExecutorTests, destructor_runs_pending_tasks) {
+  std::atomic<int> count{0};
+  {
+    WorkStealingExecutor executor{2};
+    for (int i = 0; i < 1000; i++) {
+      executor.submit([&]() { count++; });
+    }
+  }
+  EXPECT_EQ(count.load(), 1000);
+}
+
+struct DetachedTask {
+  struct promise_type {
+    DetachedTask get_return_object() { return {}; }
+    std::suspend_never initial_suspend() noexcept { return {}; }
+    std::suspend_never final_suspend() noexcept { return {}; }
+    void return_void() {}
+    void unhandled_exception() { std::terminate(); }
+  };
+};
+
+TEST(WorkStealingExecutorTests, resumes_queue_awaiters) {
+  WorkStealingExecutor executor{2};
+  MPMCQueue<uint64_t*> queue;
+  std::latch done{1};
+  uint64_t* popped = nullptr;
+
+  auto consumer = [&]() -> DetachedTask {
+    popped = co_await queue.async_pop(executor);
+    done.count_down();
+  };
+  consumer();
+
+  uint64_t v;
+  queue.push(&v);
+  done.wait();
+  EXPECT_EQ(popped, &v);
+}
+
+}  // namespace theta
@@ -0,0 +1,127 @@
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "theta/queue/fair-queue.h"
+
+namespace theta {
+
+TEST(FairQueueTests, weighted_round_robin) {
+  FairQueue<uint64_t> queue{{3, 1}, QueueOpts{}.set_max_size(16)};
+  for (uint64_t i = 1; i <= 8; i++) {
+    EXPECT_TRUE(queue.try_push(0, 100 + i));
+    EXPECT_TRUE(queue.try_push(1, 200 + i));
+  }
+
+  std::string order;
+  while (auto val = queue.try_pop()) {
+    order += *val < 200 ? 'a' : 'b';
+  }
+  EXPECT_EQ(order, "aaabaaabaabbbbbb");
+  EXPECT_FALSE(queue.try_pop().has_value());
+}
+
+TEST(FairQueueTests, skips_idle_tenants) {
+  FairQueue<uint64_t> queue{std::vector<uint32_t>(200, 1),
+                            QueueOpts{}.set_max_size(4)};
+  for (size_t tenant : {150, 3, 64, 199}) {
+    EXPECT_TRUE(queue.try_push(tenant, tenant + 1));
+  }
+  std::vector<uint64_t> popped;
+  while (auto val = queue.try_pop()) {
+    popped.push_back(*val - 1);
+  }
+  EXPECT_EQ(popped, (std::vector<uint64_t>{3, 64, 150, 199}));
+  EXPECT_EQ(queue.size(3), 0);
+}
+
+// A heavy and a light tenant push concurrently into a blocking consumer.
+// Every item arrives, in order within its tenant.
+TEST(FairQueueTests, concurrent_tenants) {
+  static constexpr uint64_t kHeavyItems = 100000;
+  static constexpr uint64_t kLightItems = 1000;
+  FairQueue<uint64_t> queue{{1, 1}, QueueOpts{}.set_max_size(64)};
+
+  auto producer = [&](size_t tenant, uint64_t num_items) {
+    for (uint64_t i = 1; i <= num_items; i++) {
+      while (!queue.try_push(tenant, (uint64_t{tenant} << 32) | i)) {
+        std::this_thread::yield();
+      }
+    }
+  };
+  std::thread heavy{producer, 0, kHeavyItems};
+  std::thread light{producer, 1, kLightItems};
+
+  uint64_t next[2] = {1, 1};
+  for (uint64_t n = 0; n < kHeavyItems + kLightItems; n++) {
+    uint64_t val = queue.pop();
+    EXPECT_EQ(val & 0xffffffff, next[val >> 32]++);
+  }
+  heavy.join();
+  light.join();
+  EXPECT_EQ(next[0], kHeavyItems + 1);
+  EXPECT_EQ(next[1], kLightItems + 1);
+}
+
+// Several consumers pop at once. Each item arrives exactly once, and each
+// consumer sees every tenant's items in order.
+TEST(FairQueueTests, concurrent_consumers) {
+  static constexpr size_t kNumTenants = 4;
+  static constexpr size_t kNumConsumers = 3;
+  static constexpr uint64_t kItemsPerTenant = 20000;
+  FairQueue<uint64_t> queue{{1, 2, 3, 4}, QueueOpts{}.set_max_size(64)};
+
+  std::vector<std::thread> producers;
+  for (size_t tenant = 0; tenant < kNumTenants; tenant++) {
+    producers.emplace_back([&, tenant]() {
+      for (uint64_t i = 1; i <= kItemsPerTenant; i++) {
+        while (!queue.try_push(tenant, (uint64_t{tenant} << 32) | i)) {
+          std::this_thread::yield();
+        }
+      }
+    });
+  }
+
+  std::atomic<uint64_t> num_popped{0};
+  std::vector<std::vector<uint64_t>> counts(
+      kNumConsumers, std::vector<uint64_t>(kNumTenants, 0));
+  std::vector<std::thread> consumers;
+  for (size_t c = 0; c < kNumConsumers; c++) {
+    consumers.emplace_back([&, c]() {
+      std::vector<uint64_t> last(kNumTenants, 0);
+      while (num_popped.load() < kNumTenants * kItemsPerTenant) {
+        auto val = queue.try_pop();
+        if (!val) {
+          std::this_thread::yield();
+          continue;
+        }
+        size_t tenant = *val >> 32;
+        EXPECT_GT(*val & 0xffffffff, last[tenant]);
+        last[tenant] = *val & 0xffffffff;
+        counts[c][tenant]++;
+        num_popped++;
+      }
+    });
+  }
+
+  for (auto& t : producers) {
+    t.join();
+  }
+  for (auto& t : consumers) {
+    t.join();
+  }
+  for (size_t tenant = 0; tenant < kNumTenants; tenant++) {
+    uint64_t total = 0;
+    for (size_t c = 0; c < kNumConsumers; c++) {
+      total += counts[c][tenant];
+    }
+    EXPECT_EQ(total, kItemsPerTenant);
+  }
+  EXPECT_FALSE(queue.try_pop().has_value());
+}
+
+}  // namespace theta
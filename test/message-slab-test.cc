@@ -0,0 +1,95 @@
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "theta/queue/message-slab.h"
+
+namespace theta {
+
+TEST(MessageSlabTests, allocate_until_exhausted) {
+  MessageSlab<std::string> slab{8};
+  std::set<uint32_t> handles;
+  for (int i = 0; i < 8; i++) {
+    auto h = slab.try_emplace(std::to_string(i));
+    ASSERT_TRUE(h.has_value());
+    EXPECT_EQ(slab[*h], std::to_string(i));
+    handles.insert(*h);
+  }
+  EXPECT_EQ(handles.size(), 8);
+  EXPECT_FALSE(slab.try_emplace("full").has_value());
+
+  slab.release(*handles.begin());
+  auto h = slab.try_emplace("reused");
+  ASSERT_TRUE(h.has_value());
+  EXPECT_EQ(*h, *handles.begin());
+
+  handles.erase(handles.begin());
+  handles.insert(*h);
+  for (uint32_t handle : handles) {
+    slab.release(handle);
+  }
+}
+
+TEST(MessageSlabTests, slots_are_cache_aligned) {
+  MessageSlab<uint64_t> slab{2};
+  auto a = slab.try_emplace(1);
+  auto b = slab.try_emplace(2);
+  auto distance = reinterpret_cast<uintptr_t>(&slab[*b])
+                - reinterpret_cast<uintptr_t>(&slab[*a]);
+  EXPECT_EQ(distance % hardware_constructive_interference_size, 0);
+  slab.release(*a);
+  slab.release(*b);
+}
+
+struct Payload {
+  uint64_t producer;
+  uint64_t seq;
+  uint64_t check;
+};
+
+TEST(SlabQueueTests, concurrent_producers_and_consumers) {
+  static constexpr int kNumProducers = 4;
+  static constexpr int kNumConsumers = 4;
+  static constexpr uint64_t kItemsPerProducer = 10000;
+  SlabQueue<Payload, 64> queue;
+  std::atomic<uint64_t> consumed{0};
+  std::atomic<uint64_t> sum{0};
+  std::atomic<uint64_t> corrupt{0};
+
+  std::vector<std::thread> threads;
+  for (int p = 0; p < kNumProducers; p++) {
+    threads.emplace_back([&, p]() {
+      for (uint64_t i = 0; i < kItemsPerProducer; i++) {
+        queue.emplace(Payload{
+            .producer = static_cast<uint64_t>(p), .seq = i, .check = p ^ i});
+      }
+    });
+  }
+  for (int c = 0; c < kNumConsumers; c++) {
+    threads.emplace_back([&]() {
+      while (consumed.load() < kNumProducers * kItemsPerProducer) {
+        queue.try_consume([&](Payload& msg) {
+          if ((msg.producer ^ msg.seq) != msg.check) {
+            corrupt++;
+          }
+          sum += msg.seq;
+          consumed++;
+        });
+      }
+    });
+  }
+  for (auto& t : threads) {
+    t.join();
+  }
+
+  EXPECT_EQ(corrupt, 0);
+  EXPECT_EQ(sum,
+            kNumProducers * kItemsPerProducer * (kItemsPerProducer - 1) / 2);
+  EXPECT_EQ(queue.size(), 0);
+}
+
+}  // namespace theta
@@ -0,0 +1,120 @@
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <cstdint>
+#include <optional>
+#include <thread>
+#include <vector>
+
+#include "theta/queue/partitioned-queue.h"
+
+namespace theta {
+
+TEST(PartitionedQueueTests, lag_per_partition) {
+  PartitionedQueue<uint64_t> queue{4, QueueOpts{}.set_max_size(16)};
+  for (uint64_t i = 1; i <= 3; i++) {
+    EXPECT_TRUE(queue.try_push(/*key=*/7, i));
+  }
+
+  std::vector<size_t> expected(4, 0);
+  expected[queue.partition_of(7)] = 3;
+  EXPECT_EQ(queue.lags(), expected);
+
+  auto consumer = queue.join();
+  EXPECT_EQ(consumer.poll([](uint64_t) {}, /*budget=*/2), 2);
+  EXPECT_EQ(queue.lag(queue.partition_of(7)), 1);
+}
+
+TEST(PartitionedQueueTests, partitions_move_between_polls) {
+  PartitionedQueue<uint64_t> queue{4, QueueOpts{}.set_max_size(64)};
+  auto first = queue.join();
+  first.poll([](uint64_t) {});
+  EXPECT_EQ(first.partitions().size(), 4);
+
+  std::optional<PartitionedQueue<uint64_t>::Consumer> second{queue.join()};
+  // The first consumer still holds every partition, so the second one waits.
+  for (uint64_t key = 0; key < 64; key++) {
+    EXPECT_TRUE(queue.try_push(key, key + 1));
+  }
+  EXPECT_EQ(second->poll([](uint64_t) {}), 0);
+  EXPECT_EQ(second->partitions().size(), 2);
+
+  // Polling hands half of them over.
+  size_t n = first.poll([](uint64_t) {}, /*budget=*/SIZE_MAX);
+  EXPECT_EQ(first.partitions().size(), 2);
+  n += second->poll([](uint64_t) {}, /*budget=*/SIZE_MAX);
+  EXPECT_EQ(n, 64);
+
+  // Leaving hands them back.
+  second.reset();
+  first.poll([](uint64_t) {});
+  EXPECT_EQ(first.partitions().size(), 4);
+}
+
+// Consumers join and leave while producers run. Each key belongs to one
+// producer, and its items must be seen complete and in order.
+TEST(PartitionedQueueTests, per_key_order_across_rebalancing) {
+  static constexpr size_t kNumProducers = 3;
+  static constexpr uint64_t kKeysPerProducer = 8;
+  static constexpr uint64_t kItemsPerKey = 5000;
+  static constexpr uint64_t kNumKeys = kNumProducers * kKeysPerProducer;
+  static constexpr uint64_t kTotal = kNumKeys * kItemsPerKey;
+  PartitionedQueue<uint64_t> queue{8, QueueOpts{}.set_max_size(64)};
+
+  std::vector<std::atomic<uint64_t>> next_seq(kNumKeys);
+  std::atomic<uint64_t> received{0};
+  auto on_item = [&](uint64_t item) {
+    uint64_t key = item >> 32;
+    uint64_t seq = (item & 0xffffffff) - 1;
+    EXPECT_EQ(seq, next_seq[key].load(std::memory_order::relaxed));
+    next_seq[key].store(seq + 1, std::memory_order::relaxed);
+    received.fetch_add(1, std::memory_order::relaxed);
+  };
+
+  std::vector<std::thread> producers;
+  for (uint64_t p = 0; p < kNumProducers; p++) {
+    producers.emplace_back([&, p]() {
+      for (uint64_t seq = 0; seq < kItemsPerKey; seq++) {
+        for (uint64_t k = 0; k < kKeysPerProducer; k++) {
+          uint64_t key = p * kKeysPerProducer + k;
+          queue.push(key, (key << 32) | (seq + 1));
+        }
+      }
+    });
+  }
+
+  // The first consumer stays until the end; the others come and go.
+  std::vector<std::thread> consumers;
+  consumers.emplace_back([&]() {
+    auto consumer = queue.join();
+    while (received.load(std::memory_order::relaxed) < kTotal) {
+      if (consumer.poll(on_item) == 0) {
+        std::this_thread::yield();
+      }
+    }
+  });
+  for (int c = 0; c < 2; c++) {
+    consumers.emplace_back([&, c]() {
+      for (int round = 0; round < 20; round++) {
+        auto consumer = queue.join();
+        for (int i = 0; i < 50 + c * 30; i++) {
+          if (consumer.poll(on_item) == 0) {
+            std::this_thread::yield();
+          }
+        }
+      }
+    });
+  }
+
+  for (auto& t : producers) {
+    t.join();
+  }
+  for (auto& t : consumers) {
+    t.join();
+  }
+  for (auto& seq : next_seq) {
+    EXPECT_EQ(seq.load(), kItemsPerKey);
+  }
+}
+
+}  // namespace theta
@@ -1,11 +1,24 @@
 #include <gtest/gtest.h>
+#include <poll.h>
+#include <sys/mman.h>
+#include <unistd.h>
 
 #include <array>
+#include <coroutine>
+#include <deque>
+#include <fstream>
 #include <random>
 #include <shared_mutex>
 
+#include "theta/queue/batcher.h"
 #include "theta/queue/mpmc-queue.h"
 #include "theta/queue/mpsc-queue.h"
+#include "theta/queue/page-buffer.h"
+#include "theta/queue/readiness-notifier.h"
+#include "theta/queue/ready-set.h"
+#include "theta/queue/reorder-buffer.h"
+#include "theta/queue/slot-scan.h"
+#include "theta/queue/wait-any.h"
 
 namespace theta {
 
@@ -138,4 +151,851 @@ TYPED_TEST(QueueTests, DISABLED_multithreaded_stress) {
             kNumThreads * kPushesPerThread * (kPushesPerThread - 1) / 2);
 }
 
+template <bool kAsymmetricFences>
+static void mpsc_drain_to_collects_all_pushes() {
+  static constexpr uint64_t kPushesPerThread = 10000;
+  static constexpr int kNumThreads = 4;
+  MPSCQueue<uint64_t*, kAsymmetricFences> queue{
+      QueueOpts{}.set_max_size(256)};
+
+  uint64_t total_sum = 0;
+  auto consume = [&](uint64_t* v) {
+    total_sum += *v;
+    delete v;
+  };
+
+  std::array<std::thread, kNumThreads> threads;
+  for (int tx = 0; tx < kNumThreads; tx++) {
+    threads[tx] = std::thread([&]() {
+      for (uint64_t i = 0; i < kPushesPerThread; i++) {
+        auto* v = new uint64_t{i};
+        while (!queue.try_push(v)) {
+          std::this_thread::yield();
+        }
+      }
+    });
+  }
+
+  static constexpr uint64_t kExpectedSum
+      = kNumThreads * kPushesPerThread * (kPushesPerThread - 1) / 2;
+  while (total_sum < kExpectedSum) {
+    queue.drain_to(consume);
+    std::this_thread::yield();
+  }
+
+  for (auto& t : threads) {
+    t.join();
+  }
+  EXPECT_EQ(total_sum, kExpectedSum);
+  EXPECT_EQ(queue.drain_to(consume), 0);
+  EXPECT_EQ(queue.size(), 0);
+}
+
+TEST(MPSCQueueTests, drain_to) {
+  mpsc_drain_to_collects_all_pushes</*kAsymmetricFences=*/false>();
+}
+
+TEST(MPSCQueueTests, drain_to_asymmetric_fences) {
+  mpsc_drain_to_collects_all_pushes</*kAsymmetricFences=*/true>();
+}
+
+TEST(MPSCQueueTests, peek) {
+  MPSCQueue<uint64_t> queue{QueueOpts{}.set_max_size(16)};
+  EXPECT_FALSE(queue.peek().has_value());
+  queue.try_push(1);
+  queue.try_push(2);
+  EXPECT_EQ(queue.peek(), 1);
+  EXPECT_EQ(queue.size(), 2);
+  queue.try_pop();
+  EXPECT_EQ(queue.peek(), 2);
+  queue.try_pop();
+  EXPECT_FALSE(queue.peek().has_value());
+}
+
+TEST(ReadySetTests, take_all_returns_marked_indices_in_order) {
+  // Three levels: 64 * 64 < 5000.
+  ReadySet set{5000};
+  EXPECT_FALSE(set.any());
+
+  std::vector<size_t> marked = {0, 63, 64, 4095, 4096, 4999};
+  for (size_t i : marked) {
+    set.set(i);
+    set.set(i);
+  }
+  EXPECT_TRUE(set.any());
+
+  std::vector<size_t> taken;
+  EXPECT_EQ(set.take_all([&](size_t i) { taken.push_back(i); }), 6);
+  EXPECT_EQ(taken, marked);
+  EXPECT_FALSE(set.any());
+  EXPECT_EQ(set.take_all([](size_t) {}), 0);
+}
+
+TEST(InboxSetTests, dispatches_every_item) {
+  static constexpr size_t kNumInboxes = 1000;
+  static constexpr int kNumProducers = 4;
+  static constexpr uint64_t kItemsPerProducer = 20000;
+  InboxSet<uint64_t> inboxes{kNumInboxes, QueueOpts{}.set_max_size(16)};
+
+  std::vector<std::thread> producers;
+  for (int p = 0; p < kNumProducers; p++) {
+    producers.emplace_back([&, p]() {
+      for (uint64_t i = 1; i <= kItemsPerProducer; i++) {
+        size_t inbox = (i * 7919 + p) % kNumInboxes;
+        while (!inboxes.try_push(inbox, i)) {
+          std::this_thread::yield();
+        }
+      }
+    });
+  }
+
+  uint64_t received = 0;
+  uint64_t sum = 0;
+  while (received < kNumProducers * kItemsPerProducer) {
+    inboxes.wait();
+    received += inboxes.dispatch(
+        [&](size_t inbox, uint64_t v) {
+          EXPECT_LT(inbox, kNumInboxes);
+          sum += v;
+        },
+        /*budget=*/4);
+  }
+  for (auto& t : producers) {
+    t.join();
+  }
+  EXPECT_EQ(sum,
+            kNumProducers * kItemsPerProducer * (kItemsPerProducer + 1) / 2);
+}
+
+TEST(MPMCQueueTests, peek) {
+  MPMCQueue<uint64_t, 4> queue;
+  EXPECT_FALSE(queue.peek().has_value());
+  // Wrap around the buffer a few times.
+  for (uint64_t i = 1; i <= 10; i++) {
+    queue.push(i);
+    queue.push(i + 100);
+    EXPECT_EQ(queue.peek(), i);
+    EXPECT_EQ(queue.pop(), i);
+    EXPECT_EQ(queue.peek(), i + 100);
+    EXPECT_EQ(queue.pop(), i + 100);
+    EXPECT_FALSE(queue.peek().has_value());
+  }
+}
+
+TEST(MPMCQueueTests, compact_slot_values_round_trip) {
+  MPMCQueue<int32_t, 4> ints;
+  MPMCQueue<float, 4> floats;
+  for (int32_t v : {0, -1, INT32_MIN, INT32_MAX, 7}) {
+    ints.push(v);
+    EXPECT_EQ(ints.pop(), v);
+    floats.push(v * 0.5f);
+    EXPECT_EQ(floats.pop(), v * 0.5f);
+  }
+}
+
+// Blocking pushes and pops on a small buffer, so that threads frequently wait
+// on slots that have not been released by the previous lap yet.
+template <typename T>
+static void mpmc_blocking_push_pop_many_laps(QueueOpts opts = QueueOpts{}) {
+  static constexpr uint64_t kPushesPerThread = 20000;
+  static constexpr int kNumThreads = 4;
+  MPMCQueue<T, 8> queue{opts};
+
+  std::vector<std::thread> threads;
+  std::atomic<uint64_t> total_sum{0};
+  for (int tx = 0; tx < kNumThreads; tx++) {
+    threads.emplace_back([&]() {
+      for (uint64_t i = 0; i < kPushesPerThread; i++) {
+        queue.push(static_cast<T>(i));
+      }
+    });
+    threads.emplace_back([&]() {
+      uint64_t sum = 0;
+      for (uint64_t i = 0; i < kPushesPerThread; i++) {
+        sum += queue.pop();
+      }
+      total_sum += sum;
+    });
+  }
+  for (auto& t : threads) {
+    t.join();
+  }
+
+  EXPECT_EQ(total_sum,
+            kNumThreads * kPushesPerThread * (kPushesPerThread - 1) / 2);
+  EXPECT_EQ(queue.size(), 0);
+}
+
+TEST(MPMCQueueTests, blocking_push_pop_compact_slots) {
+  mpmc_blocking_push_pop_many_laps<uint32_t>();
+}
+
+TEST(MPMCQueueTests, blocking_push_pop_wide_slots) {
+  mpmc_blocking_push_pop_many_laps<uint64_t>();
+}
+
+TEST(MPMCQueueTests, batched_wakeups_compact_slots) {
+  mpmc_blocking_push_pop_many_laps<uint32_t>(
+      QueueOpts{}.set_wakeup_batching(4, std::chrono::microseconds{50}));
+}
+
+TEST(MPMCQueueTests, batched_wakeups_wide_slots) {
+  mpmc_blocking_push_pop_many_laps<uint64_t>(
+      QueueOpts{}.set_wakeup_batching(4, std::chrono::microseconds{50}));
+}
+
+// A lone item never fills the batch, so its consumer wakes on the deadline.
+TEST(MPMCQueueTests, batched_wakeup_deadline) {
+  MPMCQueue<uint64_t, 16> queue{
+      QueueOpts{}.set_wakeup_batching(8, std::chrono::milliseconds{1})};
+
+  std::atomic<bool> popped{false};
+  std::thread consumer{[&]() {
+    EXPECT_EQ(queue.pop(), 42);
+    popped = true;
+  }};
+  std::this_thread::sleep_for(std::chrono::milliseconds{5});
+  EXPECT_FALSE(popped);
+
+  queue.push(42);
+  consumer.join();
+  EXPECT_TRUE(popped);
+}
+
+// Several parked consumers, and fewer items than a batch with no push after
+// them. The consumers that get the items still wake by the deadline.
+TEST(MPMCQueueTests, batched_wakeups_flush_at_deadline) {
+  static constexpr auto kDelay = std::chrono::milliseconds{20};
+  MPMCQueue<uint64_t, 16> queue{QueueOpts{}.set_wakeup_batching(8, kDelay)};
+
+  std::atomic<int> num_popped{0};
+  std::vector<std::thread> consumers;
+  for (int i = 0; i < 4; i++) {
+    consumers.emplace_back([&]() {
+      queue.pop();
+      num_popped++;
+    });
+  }
+  std::this_thread::sleep_for(std::chrono::milliseconds{20});
+  EXPECT_EQ(num_popped, 0);
+
+  auto start = std::chrono::steady_clock::now();
+  queue.push(1);
+  queue.push(2);
+  while (num_popped < 2
+         && std::chrono::steady_clock::now() - start < kDelay * 10) {
+    std::this_thread::yield();
+  }
+  EXPECT_EQ(num_popped, 2);
+
+  queue.push(3);
+  queue.push(4);
+  for (auto& t : consumers) {
+    t.join();
+  }
+}
+
+TEST(PageBufferTests, prefault_makes_every_page_resident) {
+  internal::PageBuffer<uint64_t> buffer{1 << 16};
+  buffer.prefault(/*num_threads=*/3);
+
+  const size_t page = sysconf(_SC_PAGESIZE);
+  const size_t num_pages = (buffer.size() * sizeof(uint64_t) + page - 1) / page;
+  std::vector<unsigned char> resident(num_pages);
+  ASSERT_EQ(mincore(buffer.data(), num_pages * page, resident.data()), 0);
+  for (size_t i = 0; i < num_pages; i++) {
+    EXPECT_TRUE(resident[i] & 1) << "page " << i;
+  }
+  for (size_t i = 0; i < buffer.size(); i++) {
+    ASSERT_EQ(buffer[i], 0);
+  }
+}
+
+TEST(PageBufferTests, small_buffer_is_heap_allocated) {
+  internal::PageBuffer<uint64_t> small{16};
+  EXPECT_FALSE(small.mapped());
+  EXPECT_EQ(reinterpret_cast<uintptr_t>(small.data()) %
+                hardware_destructive_interference_size,
+            0);
+  for (size_t i = 0; i < small.size(); i++) {
+    ASSERT_EQ(small[i], 0);
+  }
+
+  internal::PageBuffer<uint64_t> pinned{16, /*map_pages=*/true};
+  EXPECT_TRUE(pinned.mapped());
+  pinned.prefault();
+  EXPECT_EQ(pinned[15], 0);
+}
+
+TEST(MPMCQueueTests, prefaulted_locked_buffer) {
+  MPMCQueue<uint64_t, 1 << 12> queue{
+      QueueOpts{}.set_prefault(/*num_threads=*/2).set_lock_memory(true)};
+  // mlock() may be refused under a small RLIMIT_MEMLOCK, and the queue works
+  // either way.
+  for (uint64_t i = 0; i < 3 * queue.capacity(); i++) {
+    queue.push(i);
+    EXPECT_EQ(queue.pop(), i);
+  }
+}
+
+static size_t resident_bytes() {
+  std::ifstream statm{"/proc/self/statm"};
+  size_t size, resident;
+  statm >> size >> resident;
+  return resident * sysconf(_SC_PAGESIZE);
+}
+
+// The slot array starts out as zero pages, so constructing a queue touches
+// none of it and a push touches only the page of its slot.
+TEST(MPMCQueueTests, construction_leaves_buffer_untouched) {
+  using BigQueue = MPMCQueue<uint64_t, 1 << 20>;
+  size_t before = resident_bytes();
+  auto queue = std::make_unique<BigQueue>();
+  for (uint64_t i = 0; i < 100; i++) {
+    queue->push(i);
+  }
+  EXPECT_LT(resident_bytes() - before, 1 << 20);
+
+  for (uint64_t i = 0; i < 100; i++) {
+    EXPECT_EQ(queue->pop(), i);
+  }
+}
+
+// Discards a wrapped, partly consumed queue, then runs it for several more
+// laps, so that producers meet every kind of stale slot.
+template <typename T>
+static void mpmc_reset_discards_items() {
+  static constexpr size_t kSize = 16;
+  MPMCQueue<T, kSize> queue;
+  for (uint64_t i = 0; i < kSize + 5; i++) {
+    queue.push(static_cast<T>(i));
+    queue.pop();
+  }
+  for (uint64_t i = 0; i < kSize - 1; i++) {
+    queue.push(static_cast<T>(i));
+  }
+  for (int i = 0; i < 3; i++) {
+    queue.pop();
+  }
+
+  queue.reset();
+  EXPECT_EQ(queue.size(), 0);
+  EXPECT_FALSE(queue.try_pop());
+
+  for (uint64_t lap = 0; lap < 4; lap++) {
+    for (uint64_t i = 0; i < kSize - 1; i++) {
+      EXPECT_TRUE(queue.try_push(static_cast<T>(i + 100)));
+    }
+    EXPECT_FALSE(queue.try_push(0));
+    for (uint64_t i = 0; i < kSize - 1; i++) {
+      EXPECT_EQ(queue.pop(), static_cast<T>(i + 100));
+    }
+  }
+}
+
+TEST(MPMCQueueTests, reset_compact_slots) {
+  mpmc_reset_discards_items<uint32_t>();
+}
+
+TEST(MPMCQueueTests, reset_wide_slots) {
+  mpmc_reset_discards_items<uint64_t>();
+}
+
+TEST(MPMCQueueTests, reset_then_concurrent_use) {
+  MPMCQueue<uint64_t, 8> queue;
+  for (uint64_t i = 0; i < 5; i++) {
+    queue.push(i);
+  }
+  queue.reset();
+
+  std::thread producer{[&]() {
+    for (uint64_t i = 1; i <= 1000; i++) {
+      queue.push(i);
+    }
+  }};
+  uint64_t sum = 0;
+  for (int i = 0; i < 1000; i++) {
+    sum += queue.pop();
+  }
+  producer.join();
+  EXPECT_EQ(sum, 1000 * 1001 / 2);
+}
+
+TEST(MPMCQueueTests, drain_to) {
+  MPMCQueue<uint64_t, 256> queue;
+  for (uint64_t i = 0; i < 200; i++) {
+    queue.push(i);
+  }
+  std::vector<uint64_t> drained;
+  EXPECT_EQ(queue.drain_to([&](uint64_t v) { drained.push_back(v); }), 200);
+  ASSERT_EQ(drained.size(), 200);
+  for (uint64_t i = 0; i < 200; i++) {
+    EXPECT_EQ(drained[i], i);
+  }
+  EXPECT_EQ(queue.size(), 0);
+}
+
+TEST(MPMCQueueTests, pop_sequence_numbers) {
+  MPMCQueue<uint32_t, 4> queue;
+  uint64_t seq;
+  for (uint32_t i = 0; i < 10; i++) {
+    queue.push(i);
+    EXPECT_EQ(queue.pop(&seq), i);
+    EXPECT_EQ(seq, i);
+  }
+  queue.push(10);
+  EXPECT_EQ(queue.try_pop(&seq), 10);
+  EXPECT_EQ(seq, 10);
+
+  // Discarded items leave a gap.
+  queue.push(11);
+  queue.reset();
+  queue.push(12);
+  EXPECT_EQ(queue.try_pop(&seq), 12);
+  EXPECT_EQ(seq, 12);
+}
+
+TEST(ReorderBufferTests, drains_consecutive_run) {
+  ReorderBuffer<uint64_t, 4> buffer;
+  std::vector<uint64_t> out;
+  auto collect = [&](uint64_t v) { out.push_back(v); };
+
+  EXPECT_TRUE(buffer.try_insert(1, 101));
+  EXPECT_TRUE(buffer.try_insert(3, 103));
+  EXPECT_FALSE(buffer.try_insert(4, 104));
+  EXPECT_EQ(buffer.drain(collect), 0);
+
+  EXPECT_TRUE(buffer.try_insert(0, 100));
+  EXPECT_EQ(buffer.drain(collect), 2);
+  EXPECT_EQ(buffer.next_seq(), 2);
+  EXPECT_TRUE(buffer.try_insert(4, 104));
+  EXPECT_TRUE(buffer.try_insert(2, 102));
+  EXPECT_EQ(buffer.drain(collect, /*max_items=*/2), 2);
+  EXPECT_EQ(buffer.drain(collect), 1);
+  EXPECT_EQ(out, (std::vector<uint64_t>{100, 101, 102, 103, 104}));
+}
+
+// Workers pop items from an MPMCQueue and finish them in any order; the
+// sequencer must still see them in push order.
+TEST(ReorderBufferTests, restores_order_after_parallel_workers) {
+  static constexpr uint64_t kNumItems = 100000;
+  static constexpr int kNumWorkers = 4;
+  MPMCQueue<uint64_t, 256> queue;
+  ReorderBuffer<uint64_t, 64> buffer;
+
+  std::vector<std::thread> workers;
+  for (int w = 0; w < kNumWorkers; w++) {
+    workers.emplace_back([&]() {
+      while (true) {
+        uint64_t seq;
+        uint64_t item = queue.pop(&seq);
+        if (item == 0) {
+          return;
+        }
+        if (item % 7 == 0) {
+          std::this_thread::yield();
+        }
+        buffer.insert(seq, item);
+      }
+    });
+  }
+
+  std::thread producer{[&]() {
+    for (uint64_t i = 1; i <= kNumItems; i++) {
+      queue.push(i);
+    }
+    for (int w = 0; w < kNumWorkers; w++) {
+      queue.push(0);
+    }
+  }};
+
+  uint64_t expected = 1;
+  while (expected <= kNumItems) {
+    if (buffer.drain([&](uint64_t v) { EXPECT_EQ(v, expected++); }) == 0) {
+      std::this_thread::yield();
+    }
+  }
+  producer.join();
+  for (auto& t : workers) {
+    t.join();
+  }
+}
+
+TEST(SlotScanTests, implementations_agree) {
+  using internal::ScanImpl;
+  std::vector<ScanImpl> impls{ScanImpl::kScalar};
+#if defined(__x86_64__)
+  if (__builtin_cpu_supports("sse4.1")) {
+    impls.push_back(ScanImpl::kSse);
+  }
+  if (__builtin_cpu_supports("avx2")) {
+    impls.push_back(ScanImpl::kAvx2);
+  }
+#endif
+
+  static constexpr uint64_t kMask = ~(1ULL << 62);
+  for (size_t n = 0; n <= 19; n++) {
+    for (size_t bad = 0; bad <= n; bad++) {
+      // Wide layout: a value word, then the tag, which counts up from 100.
+      std::vector<uint64_t> wide(2 * n + 1);
+      // Compact layout: every tag is 7 << 32, with a value in the low half.
+      std::vector<uint64_t> compact(n + 1);
+      for (size_t i = 0; i < n; i++) {
+        wide[2 * i] = ~0ULL;
+        wide[2 * i + 1] = (100 + i) | ((i % 3 == 0) ? (1ULL << 62) : 0);
+        compact[i] = (7ULL << 32) | (i * 0x01010101);
+      }
+      if (bad < n) {
+        wide[2 * bad + 1] += 1;
+        compact[bad] += 1ULL << 32;
+      }
+
+      for (ScanImpl impl : impls) {
+        EXPECT_EQ(internal::scan_tags<2>(wide.data(), n, kMask, 100, 1, impl),
+                  bad)
+            << "n=" << n << " impl=" << static_cast<int>(impl);
+        EXPECT_EQ(internal::scan_tags<1>(compact.data(),
+                                         n,
+                                         0xBFFFFFFF00000000,
+                                         7ULL << 32,
+                                         0,
+                                         impl),
+                  bad)
+            << "n=" << n << " impl=" << static_cast<int>(impl);
+      }
+    }
+  }
+}
+
+template <typename T>
+static void mpmc_try_pop_n_takes_ready_prefix() {
+  MPMCQueue<T, 16> queue;
+  T out[32];
+  EXPECT_EQ(queue.try_pop_n(out, 32), 0);
+
+  // Wrap around the buffer several times with partial batches.
+  uint64_t next_push = 1;
+  uint64_t next_pop = 1;
+  for (int round = 0; round < 20; round++) {
+    for (int i = 0; i < 11; i++) {
+      queue.push(static_cast<T>(next_push++));
+    }
+    size_t n = queue.try_pop_n(out, 4);
+    EXPECT_EQ(n, 4);
+    n += queue.try_pop_n(out + n, 32);
+    EXPECT_EQ(n, 11);
+    for (size_t i = 0; i < n; i++) {
+      EXPECT_EQ(out[i], static_cast<T>(next_pop++));
+    }
+  }
+  EXPECT_EQ(queue.size(), 0);
+}
+
+TEST(MPMCQueueTests, try_pop_n_compact_slots) {
+  mpmc_try_pop_n_takes_ready_prefix<uint32_t>();
+}
+
+TEST(MPMCQueueTests, try_pop_n_wide_slots) {
+  mpmc_try_pop_n_takes_ready_prefix<uint64_t>();
+}
+
+TEST(MPMCQueueTests, try_pop_n_concurrent) {
+  static constexpr uint64_t kPushesPerThread = 20000;
+  static constexpr int kNumThreads = 4;
+  MPMCQueue<uint64_t, 64> queue;
+
+  std::vector<std::thread> threads;
+  std::atomic<uint64_t> total_sum{0};
+  std::atomic<uint64_t> total_popped{0};
+  for (int tx = 0; tx < kNumThreads; tx++) {
+    threads.emplace_back([&]() {
+      for (uint64_t i = 0; i < kPushesPerThread; i++) {
+        queue.push(i);
+      }
+    });
+    threads.emplace_back([&]() {
+      uint64_t out[16];
+      while (total_popped.load() < kNumThreads * kPushesPerThread) {
+        size_t n = queue.try_pop_n(out, 16);
+        uint64_t sum = 0;
+        for (size_t i = 0; i < n; i++) {
+          sum += out[i];
+        }
+        total_sum += sum;
+        total_popped += n;
+        if (n == 0) {
+          std::this_thread::yield();
+        }
+      }
+    });
+  }
+  for (auto& t : threads) {
+    t.join();
+  }
+
+  EXPECT_EQ(total_popped, kNumThreads * kPushesPerThread);
+  EXPECT_EQ(total_sum,
+            kNumThreads * kPushesPerThread * (kPushesPerThread - 1) / 2);
+}
+
+// A fire-and-forget coroutine for exercising the queue awaitables.
+struct DetachedTask {
+  struct promise_type {
+    DetachedTask get_return_object() { return {}; }
+    std::suspend_never initial_suspend() noexcept { return {}; }
+    std::suspend_never final_suspend() noexcept { return {}; }
+    void return_void() {}
+    void unhandled_exception() { std::terminate(); }
+  };
+};
+
+// Collects resumed coroutines so that the test decides when they run.
+struct ManualExecutor {
+  void schedule(std::coroutine_handle<> h) {
+    std::lock_guard l{mu};
+    handles.push_back(h);
+  }
+
+  bool run_one() {
+    std::coroutine_handle<> h;
+    {
+      std::lock_guard l{mu};
+      if (handles.empty()) {
+        return false;
+      }
+      h = handles.front();
+      handles.pop_front();
+    }
+    h.resume();
+    return true;
+  }
+
+  std::mutex mu;
+  std::deque<std::coroutine_handle<>> handles;
+};
+
+TEST(MPMCQueueAsyncTests, async_pop_suspends_until_push) {
+  MPMCQueue<uint64_t*> queue;
+  uint64_t* popped = nullptr;
+
+  auto consumer = [&]() -> DetachedTask {
+    popped = co_await queue.async_pop();
+  };
+  consumer();
+  EXPECT_EQ(popped, nullptr);
+
+  uint64_t v = 7;
+  queue.push(&v);
+  EXPECT_EQ(popped, &v);
+  EXPECT_EQ(queue.size(), 0);
+}
+
+TEST(MPMCQueueAsyncTests, async_push_suspends_while_full) {
+  MPMCQueue<uint64_t*, 16> queue;
+  ManualExecutor executor;
+  uint64_t values[16];
+
+  int pushed = 0;
+  auto producer = [&]() -> DetachedTask {
+    for (auto& v : values) {
+      co_await queue.async_push(&v, executor);
+      pushed++;
+    }
+  };
+  producer();
+  EXPECT_LT(pushed, 16);
+  EXPECT_FALSE(executor.run_one());
+
+  int expected = 0;
+  while (expected < 16) {
+    EXPECT_EQ(queue.pop(), &values[expected++]);
+    while (executor.run_one()) {}
+  }
+  EXPECT_EQ(pushed, 16);
+}
+
+TEST(MPMCQueueAsyncTests, async_pop_many_coroutines) {
+  static constexpr int kNumConsumers = 64;
+  static constexpr uint64_t kItemsPerConsumer = 1000;
+  MPMCQueue<uint64_t*, 32> queue;
+  ManualExecutor executor;
+  std::atomic<uint64_t> sum{0};
+  std::atomic<int> finished{0};
+
+  auto consumer = [&]() -> DetachedTask {
+    for (uint64_t i = 0; i < kItemsPerConsumer; i++) {
+      uint64_t* v = co_await queue.async_pop(executor);
+      sum += *v;
+      delete v;
+    }
+    finished++;
+  };
+  for (int i = 0; i < kNumConsumers; i++) {
+    consumer();
+  }
+
+  std::atomic<bool> done{false};
+  std::thread runner{[&]() {
+    while (!done.load()) {
+      if (!executor.run_one()) {
+        std::this_thread::yield();
+      }
+    }
+  }};
+
+  std::array<std::thread, 4> producers;
+  for (auto& p : producers) {
+    p = std::thread{[&]() {
+      for (uint64_t i = 0; i < kNumConsumers * kItemsPerConsumer / 4; i++) {
+        queue.push(new uint64_t{i});
+      }
+    }};
+  }
+  for (auto& p : producers) {
+    p.join();
+  }
+
+  while (finished.load() < kNumConsumers) {
+    std::this_thread::yield();
+  }
+  done.store(true);
+  runner.join();
+
+  uint64_t n = kNumConsumers * kItemsPerConsumer / 4;
+  EXPECT_EQ(sum.load(), 4 * n * (n - 1) / 2);
+}
+
+static bool is_readable(const ReadinessNotifier& notifier) {
+  pollfd pfd{.fd = notifier.fd(), .events = POLLIN, .revents = 0};
+  return poll(&pfd, 1, /*timeout=*/0) == 1;
+}
+
+template <typename QType>
+static void readiness_notifier_signals_on_transitions() {
+  ReadinessNotifier notifier;
+  QType queue{QueueOpts{}.set_max_size(16).set_readiness_notifier(&notifier)};
+  uint64_t values[3];
+
+  EXPECT_FALSE(is_readable(notifier));
+  EXPECT_TRUE(queue.try_push(&values[0]));
+  EXPECT_TRUE(is_readable(notifier));
+  EXPECT_TRUE(queue.try_push(&values[1]));
+
+  // Both pushes are covered by one signal.
+  notifier.consume();
+  EXPECT_FALSE(is_readable(notifier));
+
+  EXPECT_EQ(queue.try_pop(), &values[0]);
+  EXPECT_FALSE(queue.arm_notifier());
+  EXPECT_EQ(queue.try_pop(), &values[1]);
+  EXPECT_TRUE(queue.arm_notifier());
+  EXPECT_FALSE(is_readable(notifier));
+
+  EXPECT_TRUE(queue.try_push(&values[2]));
+  EXPECT_TRUE(is_readable(notifier));
+  EXPECT_EQ(queue.try_pop(), &values[2]);
+}
+
+TEST(ReadinessNotifierTests, mpmc_queue) {
+  readiness_notifier_signals_on_transitions<MPMCQueue<uint64_t*>>();
+}
+
+TEST(ReadinessNotifierTests, mpsc_queue) {
+  readiness_notifier_signals_on_transitions<MPSCQueue<uint64_t*>>();
+}
+
+TEST(WaitAnyTests, returns_ready_queue_immediately) {
+  MPMCQueue<uint64_t*> control;
+  MPSCQueue<uint64_t*> data{QueueOpts{}};
+  uint64_t v;
+
+  data.try_push(&v);
+  EXPECT_EQ(wait_any(control, data), 1);
+  control.push(&v);
+  EXPECT_EQ(wait_any(control, data), 0);
+
+  EXPECT_EQ(control.pop(), &v);
+  EXPECT_EQ(data.try_pop(), &v);
+}
+
+TEST(WaitAnyTests, wakes_on_push) {
+  MPMCQueue<uint64_t*> control;
+  MPSCQueue<uint64_t*> data{QueueOpts{}};
+  uint64_t v;
+
+  for (int round = 0; round < 100; round++) {
+    std::thread producer{[&]() {
+      std::this_thread::yield();
+      if (round % 2) {
+        control.push(&v);
+      } else {
+        data.try_push(&v);
+      }
+    }};
+
+    size_t ready = wait_any(control, data);
+    EXPECT_EQ(ready, round % 2 ? 0 : 1);
+    producer.join();
+    EXPECT_EQ(ready == 0 ? control.pop() : data.try_pop(), &v);
+  }
+}
+
+TEST(BatcherTests, size_and_deadline_limits) {
+  using namespace std::chrono_literals;
+  MPMCQueue<uint64_t, 16> queue;
+  Batcher batcher{queue, /*max_items=*/4, /*max_delay=*/20ms};
+  std::vector<uint64_t> batch;
+
+  for (uint64_t i = 1; i <= 10; i++) {
+    queue.push(i);
+  }
+  EXPECT_EQ(batcher.next_batch(batch), 4);
+  EXPECT_EQ(batch, (std::vector<uint64_t>{1, 2, 3, 4}));
+  EXPECT_EQ(batcher.next_batch(batch), 4);
+
+  auto start = std::chrono::steady_clock::now();
+  EXPECT_EQ(batcher.next_batch(batch), 2);
+  EXPECT_GE(std::chrono::steady_clock::now() - start, 20ms);
+  EXPECT_EQ(batch, (std::vector<uint64_t>{9, 10}));
+
+  EXPECT_EQ(batcher.next_batch(batch, /*max_wait=*/1ms), 0);
+  EXPECT_TRUE(batch.empty());
+
+  const BatchStats& stats = batcher.stats();
+  EXPECT_EQ(stats.num_batches, 3);
+  EXPECT_EQ(stats.num_items, 10);
+  EXPECT_EQ(stats.num_full, 2);
+  EXPECT_EQ(stats.num_timed_out, 1);
+  EXPECT_GE(stats.max_delay, 20ms);
+  EXPECT_LE(stats.mean_delay(), stats.max_delay);
+}
+
+// The batcher sleeps until a producer pushes, and the batch fills up before
+// its deadline.
+TEST(BatcherTests, wakes_on_push) {
+  using namespace std::chrono_literals;
+  static constexpr uint64_t kNumItems = 10000;
+  MPSCQueue<uint64_t> queue{QueueOpts{}.set_max_size(256)};
+  Batcher batcher{queue, /*max_items=*/64, /*max_delay=*/1s};
+
+  std::thread producer{[&]() {
+    for (uint64_t i = 1; i <= kNumItems; i++) {
+      while (!queue.try_push(i)) {
+        std::this_thread::yield();
+      }
+    }
+  }};
+
+  std::vector<uint64_t> batch;
+  uint64_t expected = 1;
+  while (expected + 64 <= kNumItems + 1) {
+    ASSERT_EQ(batcher.next_batch(batch), 64);
+    for (uint64_t v : batch) {
+      EXPECT_EQ(v, expected++);
+    }
+  }
+  producer.join();
+  EXPECT_EQ(batcher.stats().num_full, kNumItems / 64);
+}
+
 }  // namespace theta
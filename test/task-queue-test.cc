@@ -0,0 +1,119 @@
+#include <gtest/gtest.h>
+
+#include <array>
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "theta/queue/task-queue.h"
+
+namespace theta {
+
+struct CountsInstances {
+  static inline int live = 0;
+  CountsInstances() { live++; }
+  CountsInstances(const CountsInstances&) { live++; }
+  CountsInstances(CountsInstances&&) noexcept { live++; }
+  ~CountsInstances() { live--; }
+};
+
+TEST(InlineTaskTests, small_and_large_captures) {
+  using Task = InlineTask<48>;
+  int calls = 0;
+  auto small = [&calls]() { calls++; };
+  std::array<char, 128> big_capture{};
+  auto large = [&calls, big_capture]() { calls += 1 + big_capture[0]; };
+  static_assert(Task::stores_inline<decltype(small)>());
+  static_assert(!Task::stores_inline<decltype(large)>());
+  struct alignas(16) Aligned {
+    int x;
+  };
+  auto over_aligned = [&calls, a = Aligned{}]() { calls += a.x; };
+  static_assert(!Task::stores_inline<decltype(over_aligned)>());
+
+  Task a{small};
+  Task b{large};
+  a();
+  b();
+  Task c{std::move(a)};
+  Task d{std::move(b)};
+  EXPECT_FALSE(a);
+  EXPECT_FALSE(b);
+  c();
+  d();
+  EXPECT_EQ(calls, 4);
+}
+
+TEST(InlineTaskTests, move_only_capture_is_destroyed_once) {
+  {
+    InlineTask<48> task{[p = std::make_unique<CountsInstances>()]() {}};
+    InlineTask<48> moved;
+    moved = std::move(task);
+    EXPECT_EQ(CountsInstances::live, 1);
+  }
+  EXPECT_EQ(CountsInstances::live, 0);
+
+  {
+    std::array<char, 128> padding{};
+    InlineTask<48> task{
+        [p = std::make_unique<CountsInstances>(), padding]() {}};
+    InlineTask<48> moved{std::move(task)};
+    EXPECT_EQ(CountsInstances::live, 1);
+  }
+  EXPECT_EQ(CountsInstances::live, 0);
+}
+
+TEST(TaskQueueTests, fifo_and_full) {
+  TaskQueue<4> queue;
+  std::vector<int> order;
+  for (int i = 0; i < 4; i++) {
+    EXPECT_TRUE(queue.try_push([&order, i]() { order.push_back(i); }));
+  }
+  EXPECT_FALSE(queue.try_push([]() {}));
+  EXPECT_EQ(queue.size(), 4);
+
+  while (queue.try_run_one()) {
+  }
+  EXPECT_EQ(order, (std::vector<int>{0, 1, 2, 3}));
+  EXPECT_EQ(queue.size(), 0);
+}
+
+TEST(TaskQueueTests, destructor_drops_pending_tasks) {
+  {
+    TaskQueue<8> queue;
+    queue.push([c = CountsInstances{}]() {});
+    queue.push([c = CountsInstances{}]() {});
+    EXPECT_EQ(CountsInstances::live, 2);
+  }
+  EXPECT_EQ(CountsInstances::live, 0);
+}
+
+TEST(TaskQueueTests, concurrent_producers_and_consumers) {
+  static constexpr int kNumThreads = 4;
+  static constexpr uint64_t kTasksPerProducer = 20000;
+  TaskQueue<64> queue;
+  std::atomic<uint64_t> sum{0};
+
+  std::vector<std::thread> threads;
+  for (int t = 0; t < kNumThreads; t++) {
+    threads.emplace_back([&]() {
+      for (uint64_t i = 0; i < kTasksPerProducer; i++) {
+        queue.push([&sum, i]() { sum.fetch_add(i); });
+      }
+    });
+    threads.emplace_back([&]() {
+      for (uint64_t i = 0; i < kTasksPerProducer; i++) {
+        queue.pop()();
+      }
+    });
+  }
+  for (auto& t : threads) {
+    t.join();
+  }
+
+  EXPECT_EQ(sum, kNumThreads * kTasksPerProducer * (kTasksPerProducer - 1) / 2);
+  EXPECT_EQ(queue.size(), 0);
+}
+
+}  // namespace theta